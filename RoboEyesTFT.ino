@@ -10,6 +10,7 @@ bool closed = false;
 void setup() {
   tft.init();
   roboEyes.begin(100); // 50 FPS
+  roboEyes.setIdleFramerate(5); // drop to 5 FPS while the eyes are at rest
   // Optionally customize colors:
   roboEyes.setColors(TFT_WHITE, TFT_BLACK);
   // Set modes (e.g., auto blink, idle)
@@ -28,16 +29,17 @@ void setup() {
 void loop() {
   roboEyes.update();
   // your other code
+  // fadeColors() does nothing when already showing/fading to these colors
   if (digitalRead(0) == LOW) {
-    roboEyes.setColors(TFT_GREEN, TFT_BLACK);
+    roboEyes.fadeColors(TFT_GREEN, TFT_BLACK, 300);
     roboEyes.setMood(HAPPY);
   }
   else if (digitalRead(35) == LOW) {
-    roboEyes.setColors(TFT_RED, TFT_BLACK);
+    roboEyes.fadeColors(TFT_RED, TFT_BLACK, 300);
     roboEyes.setMood(ANGRY);
   }
   else {
-    roboEyes.setColors(TFT_WHITE, TFT_BLACK);
+    roboEyes.fadeColors(TFT_WHITE, TFT_BLACK, 300);
     roboEyes.setMood(DEFAULT);
   }
 }
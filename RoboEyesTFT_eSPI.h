@@ -1,7 +1,8 @@
 /*
  * TFT_RoboEyes for TFT Displays V1.1 (Double-Buffered)
  * Adapted to work with the LilyGo TTGO ESP32 with SPI ST7789V using TFT_eSPI.
- * Supports portrait (135x240) and landscape modes, two-eye or cyclops mode,
+ * Supports portrait (135x240) and landscape modes, two or more eyes spread
+ * over one or more displays, cyclops mode,
  * color customization, and expressive animations (auto-blink, idle,
  * curious, laugh, and confused).
  *
@@ -12,8 +13,151 @@
 #define _TFT_ROBOEYES_H
 
 #include <TFT_eSPI.h>
+#include <new>
 // #include <TFT_eSprite.h>  // Include the sprite class header if needed
 
+// Time and random sources: millis()/micros()/random() unless a clock or a
+// seed is set at run time (see TFT_RoboEyes::setClock() and
+// setRandomSeed()). Define these before including this header to replace
+// them at compile time instead.
+#ifndef ROBOEYES_MILLIS
+#define ROBOEYES_MILLIS() clockMillis()
+#endif
+#ifndef ROBOEYES_MICROS
+#define ROBOEYES_MICROS() clockMicros()
+#endif
+#ifndef ROBOEYES_RANDOM
+#define ROBOEYES_RANDOM(n) randomBelow(n)
+#endif
+
+// Per-frame performance statistics (render/push time, pixels, lateness).
+// Define ROBOEYES_STATS as 0 before including this header to compile them
+// out; ROBOEYES_STATS_FRAMES sets how many recent frames are kept.
+#ifndef ROBOEYES_STATS
+#define ROBOEYES_STATS 1
+#endif
+#ifndef ROBOEYES_STATS_FRAMES
+#define ROBOEYES_STATS_FRAMES 64
+#endif
+
+// Render task with a lock-free command queue (ESP32 / FreeRTOS only), see
+// TFT_RoboEyes::startRenderTask(). ROBOEYES_QUEUE_SIZE must be a power of 2.
+#ifndef ROBOEYES_TASK
+#if defined(ESP32)
+#define ROBOEYES_TASK 1
+#else
+#define ROBOEYES_TASK 0
+#endif
+#endif
+#ifndef ROBOEYES_QUEUE_SIZE
+#define ROBOEYES_QUEUE_SIZE 64
+#endif
+// Called with each command the render task takes off the queue, in order,
+// e.g. to trace or test the queue. Define before including this header.
+#ifndef ROBOEYES_COMMAND_TRACE
+#define ROBOEYES_COMMAND_TRACE(cmd)
+#endif
+#if ROBOEYES_TASK
+#include <atomic>
+#endif
+
+// Most tasks rasterizing a frame side by side, counting the one calling
+// update() (see TFT_RoboEyes::setRenderWorkers())
+#ifndef ROBOEYES_WORKERS
+#if ROBOEYES_TASK
+#define ROBOEYES_WORKERS 2
+#else
+#define ROBOEYES_WORKERS 1
+#endif
+#endif
+
+// Capacity of the eye table and of the list of displays the eyes are
+// spread over (see TFT_RoboEyes::addSurface() and addEye())
+#ifndef ROBOEYES_MAX_EYES
+#define ROBOEYES_MAX_EYES 4
+#endif
+#ifndef ROBOEYES_MAX_SURFACES
+#define ROBOEYES_MAX_SURFACES 3
+#endif
+
+// HUD elements drawn over the eyes, across all surfaces (see
+// TFT_RoboEyes::addOverlay())
+#ifndef ROBOEYES_MAX_OVERLAYS
+#define ROBOEYES_MAX_OVERLAYS 4
+#endif
+
+// Expression cache (see TFT_RoboEyes::setExpressionCache()). Define
+// ROBOEYES_CACHE as 0 to compile it out; ROBOEYES_CACHE_ENTRIES sets how
+// many frames it can hold.
+#ifndef ROBOEYES_CACHE
+#define ROBOEYES_CACHE 1
+#endif
+#ifndef ROBOEYES_CACHE_ENTRIES
+#define ROBOEYES_CACHE_ENTRIES 64
+#endif
+#define ROBOEYES_CACHE_VERSION 2
+
+// Eye textures (see TFT_RoboEyes::setEyeTexture()). Define
+// ROBOEYES_TEXTURE as 0 to compile them out. ROBOEYES_TEXTURE_LAYERS
+// bitmaps per eye (iris, pupil, highlight), scaled variants cached in
+// ROBOEYES_TEXTURE_BYTES (up to ROBOEYES_TEXTURE_ENTRIES of them), sizes
+// rounded to ROBOEYES_TEXTURE_STEP pixels.
+#ifndef ROBOEYES_TEXTURE
+#define ROBOEYES_TEXTURE 1
+#endif
+#ifndef ROBOEYES_TEXTURE_LAYERS
+#define ROBOEYES_TEXTURE_LAYERS 3
+#endif
+#ifndef ROBOEYES_TEXTURE_BYTES
+#define ROBOEYES_TEXTURE_BYTES 8192
+#endif
+#ifndef ROBOEYES_TEXTURE_ENTRIES
+#define ROBOEYES_TEXTURE_ENTRIES 16
+#endif
+#ifndef ROBOEYES_TEXTURE_STEP
+#define ROBOEYES_TEXTURE_STEP 4
+#endif
+
+// Mirror stream (see TFT_RoboEyes::setMirror()). Define ROBOEYES_MIRROR
+// as 0 to compile it out; ROBOEYES_MIRROR_BUFFER bytes are staged before
+// each write to the sink.
+#ifndef ROBOEYES_MIRROR
+#define ROBOEYES_MIRROR 1
+#endif
+#ifndef ROBOEYES_MIRROR_BUFFER
+#define ROBOEYES_MIRROR_BUFFER 64
+#endif
+#define ROBOEYES_MIRROR_VERSION 1
+
+// Gaze input (see TFT_RoboEyes::setGaze()): how long (ms) the tracker may
+// go quiet before idle mode takes over again, and the jump (1/1000 of the
+// range) that is made at once as a saccade instead of followed
+#ifndef ROBOEYES_GAZE_TIMEOUT
+#define ROBOEYES_GAZE_TIMEOUT 1000
+#endif
+#ifndef ROBOEYES_GAZE_SACCADE
+#define ROBOEYES_GAZE_SACCADE 150
+#endif
+
+// Colors a fadeColors() transition steps through
+#ifndef ROBOEYES_FADE_STEPS
+#define ROBOEYES_FADE_STEPS 32
+#endif
+
+// Summary of one measured quantity over the recorded frames
+struct RoboEyesStat {
+  uint32_t min, avg, p99, max;
+};
+
+// Result of TFT_RoboEyes::getStats()
+struct RoboEyesStats {
+  uint16_t frames;       // frames the summaries cover
+  RoboEyesStat renderUs; // drawEyes(): animation, geometry, rasterization
+  RoboEyesStat pushUs;   // sending pixels to the display
+  RoboEyesStat pixels;   // pixels pushed per frame
+  RoboEyesStat lateMs;   // how far past its deadline the frame started
+};
+
 // Default color definitions (can be changed via setColors)
 #define DEFAULT_BGCOLOR   TFT_BLACK
 #define DEFAULT_MAINCOLOR TFT_WHITE
@@ -37,66 +181,505 @@
 #define W   7  // west, middle left
 #define NW  8  // north-west, top left
 
+// Feature bits for the compile-time specialized RoboEyes<> template
+#define ROBOEYES_FEATURE_CYCLOPS  0x01
+#define ROBOEYES_FEATURE_TIRED    0x02
+#define ROBOEYES_FEATURE_ANGRY    0x04
+#define ROBOEYES_FEATURE_HAPPY    0x08
+#define ROBOEYES_FEATURE_FLICKER  0x10  // hFlicker/vFlicker
+#define ROBOEYES_FEATURE_ALL      0x1F
+
+// What a renderer is compiled for: ROBOEYES_FEATURE_* bits, and the panel
+// size and frame buffer depth, or 0 where those are only known at run time
+template <uint16_t Features, int Width = 0, int Height = 0, uint8_t Depth = 0>
+struct RoboEyesSpec {
+  static const uint16_t features = Features;
+  static const int width = Width;
+  static const int height = Height;
+  static const uint8_t depth = Depth;
+};
+
+// ---------------------------
+// Animation clips (see TFT_RoboEyes::playClip())
+//
+// A clip is a set of keyframed tracks in a compact little-endian format
+// that is read in place, from PROGMEM or any memory-mapped flash. Build
+// clips from a text description with tools/roboeyes_clip.py.
+//   0  'R' 'E'      magic
+//   2  version      ROBOEYES_CLIP_VERSION
+//   3  track count
+//   4  length       u16, ms per pass
+//   6  loops        u8, passes to play, 0 = until stopped
+//   7  reserved
+//   8  tracks       param u8, curve u8, eye mask u8 (bit i = eye i, 0 = all),
+//                   key count u8, then per key: time u16 (ms), value i16
+// Track values are offsets from what the setters ask for; clips playing
+// at the same time add up.
+#define ROBOEYES_CLIP_VERSION 1
+#ifndef ROBOEYES_CLIP_SLOTS
+#define ROBOEYES_CLIP_SLOTS 4  // clips that can play at once
+#endif
+
+// Clip track parameters
+#define ROBOEYES_CLIP_X       0  // pixels added to the eye position
+#define ROBOEYES_CLIP_Y       1
+#define ROBOEYES_CLIP_CLOSE   2  // percent closed, 100 = shut
+#define ROBOEYES_CLIP_WIDTH   3  // pixels added to the size targets
+#define ROBOEYES_CLIP_HEIGHT  4
+#define ROBOEYES_CLIP_TIRED   5  // lids, percent of half the eye height
+#define ROBOEYES_CLIP_ANGRY   6
+#define ROBOEYES_CLIP_HAPPY   7
+#define ROBOEYES_CLIP_PARAMS  8
+
+// Interpolation from one key to the next
+#define ROBOEYES_CURVE_STEP        0
+#define ROBOEYES_CURVE_LINEAR      1
+#define ROBOEYES_CURVE_EASE_IN     2
+#define ROBOEYES_CURVE_EASE_OUT    3
+#define ROBOEYES_CURVE_EASE_IN_OUT 4
+
+// Built-in clips used by blink(), the autoblinker, anim_laugh() and
+// anim_confused()
+static const uint8_t ROBOEYES_CLIP_BLINK[] PROGMEM = {    // shut for 150 ms
+  'R', 'E', ROBOEYES_CLIP_VERSION, 1, 150, 0, 1, 0,
+  ROBOEYES_CLIP_CLOSE, ROBOEYES_CURVE_STEP, 0, 1,   0, 0, 100, 0
+};
+static const uint8_t ROBOEYES_CLIP_LAUGH[] PROGMEM = {    // bounce 5 px for ~500 ms
+  'R', 'E', ROBOEYES_CLIP_VERSION, 1, 40, 0, 12, 0,
+  ROBOEYES_CLIP_Y, ROBOEYES_CURVE_STEP, 0, 2,   0, 0, 5, 0,   20, 0, 0xFB, 0xFF
+};
+static const uint8_t ROBOEYES_CLIP_CONFUSED[] PROGMEM = { // shake 20 px for ~500 ms
+  'R', 'E', ROBOEYES_CLIP_VERSION, 1, 40, 0, 12, 0,
+  ROBOEYES_CLIP_X, ROBOEYES_CURVE_STEP, 0, 2,   0, 0, 20, 0,   20, 0, 0xEC, 0xFF
+};
+
+// Sprite that draws into memory it does not own: a slice of the storage
+// given to TFT_RoboEyes::setFrameBuffer() or of its one allocation made in
+// begin(). attach() stands in for createSprite() without calloc() and
+// detach() for deleteSprite() without free(), so resizing reuses the
+// memory. Relies on TFT_eSprite's protected members (TFT_eSPI 2.x).
+class RoboEyesSprite : public TFT_eSprite {
+  public:
+    explicit RoboEyesSprite(TFT_eSPI *tft) : TFT_eSprite(tft) {}
+    ~RoboEyesSprite() { detach(); }
+
+    // Use buf as a w x h sprite at the current color depth. A 4-bit
+    // sprite keeps its palette in palette[16], also caller owned.
+    void attach(uint8_t *buf, int16_t w, int16_t h, uint16_t *palette) {
+      detach();
+      _iwidth = _dwidth = _bitwidth = w;
+      _iheight = _dheight = h;
+      if (_bpp == 1) _iwidth = _bitwidth = (w + 7) & 0xFFF8;
+      if (_bpp == 4) _iwidth = (w + 1) & 0xFFFE;
+      cursor_x = cursor_y = 0;
+      _sx = _sy = 0;
+      _sw = w;
+      _sh = h;
+      _scolor = TFT_BLACK;
+      _img8 = _img8_1 = _img8_2 = _img4 = buf;
+      _img = (uint16_t *)buf;
+      _colorMap = (_bpp == 4) ? palette : nullptr;
+      _created = true;
+      rotation = 0;
+      setViewport(0, 0, _dwidth, _dheight);
+      setPivot(_iwidth / 2, _iheight / 2);
+    }
+
+    void detach() {
+      _img = nullptr;
+      _img8 = _img8_1 = _img8_2 = _img4 = nullptr;
+      _colorMap = nullptr;
+      _created = false;
+    }
+};
+
 class TFT_RoboEyes {
   public:
-    // Reference to the TFT display object
-    TFT_eSPI *tft;
-    
-    // Off-screen drawing buffer (sprite) to reduce flicker
-    TFT_eSprite *sprite;
-
-    // Display configuration – you can update these via setScreenSize()
-    int screenWidth = 135;   // effective width (set by user)
-    int screenHeight = 240;  // effective height (set by user)
+    // Axis-aligned screen rectangle, used for dirty-region tracking
+    struct Rect {
+      int x, y, w, h;
+      bool empty() const { return w <= 0 || h <= 0; }
+    };
+
+    // Triangle lid: top edge [x0, x1] on row y - 1, height h, vertical side
+    // on the left (anchorLeft) or the right end of the top edge.
+    struct LidWedge {
+      int x0, x1, h;
+      bool anchorLeft;
+    };
+
+    // One eye as the rasterizer sees it (see rasterRow())
+    struct EyeShape {
+      int x, y, w, h, r;        // rounded rect of the eye
+      LidWedge wedges[4];       // tired + angry lids
+      uint8_t wedgeCount;
+      int happyX, happyY, happyW, happyH, happyR;  // happy (bottom) lid
+    };
+
+    // Draws a layer into the sprite it is given, e.g. with fillRect() or
+    // drawString(), in frame buffer coordinates (see setBackground())
+    typedef void (*LayerDraw)(TFT_eSprite &sprite, void *arg);
+
+    // Static-frame state: everything a surface's pixels depend on (the
+    // shapes of its eyes, the colors, the flicker phase and texture
+    // placements) packed into words, see packFrame(). The digest rules out
+    // most changed frames before the words are compared.
+    enum {
+      SHAPE_WORDS = 11 + 4 * 4,  // see packShape()
+      STATE_WORDS = ROBOEYES_MAX_EYES * SHAPE_WORDS + 2
+#if ROBOEYES_TEXTURE
+                    + ROBOEYES_MAX_EYES * ROBOEYES_TEXTURE_LAYERS * 4
+#endif
+      , CACHE_KEY_WORDS = 2 + ROBOEYES_MAX_EYES * SHAPE_WORDS  // see cachedFrame()
+    };
+    struct FrameState {
+      int32_t words[STATE_WORDS];
+      uint16_t count;
+      uint32_t digest;         // FNV-1a of the words
+    };
+
+    // Where a render worker is decoding a replayed frame (see replaySpans())
+    struct ReplayCursor {
+      int row;                 // row the cursor is on, -1 = restart
+      const uint8_t *at, *last;  // that row, last row not repeated
+    };
+
+    // A display the eyes are drawn on, with its own frame buffer(s) and
+    // dirty state. Every frame, all eyes bound to a surface are rendered
+    // into its buffer and the surface gets one push.
+    struct Surface {
+      TFT_eSPI *tft;
+      TFT_eSprite *sprite;     // buffer being drawn (and pushed)
+      int width, height;
+      uint8_t eyes[ROBOEYES_MAX_EYES];  // eyes bound here, left to right
+      uint8_t eyeCount;
+
+      // Dirty-region tracking: only the area covered by the eyes in the last
+      // and the current frame is cleared, redrawn and pushed to the display.
+      Rect dirtyRects[ROBOEYES_MAX_EYES + 1];  // regions to push for the current frame
+      uint8_t dirtyCount;
+      FrameState last;         // state of the last frame drawn here
+      bool skipped;            // nothing changed here this frame
+
+      // DMA ping-pong double buffering (see setDoubleBuffered()): frame N is
+      // sent from one buffer while frame N+1 is rendered into the other.
+      RoboEyesSprite *buffers[2];
+      uint8_t drawBuffer;      // index of the buffer being rendered
+      bool bufferInFlight[2];  // buffer is (possibly) still being sent by DMA
+      bool bufferStale[2];     // buffer needs a full redraw before its next push
+
+      int bandHeight;          // rows per band in band mode
+
+      // Expression cache replay: rows are decoded from a recorded frame
+      // instead of rasterized (see setExpressionCache())
+      const uint8_t *replay;   // recorded frame, nullptr = rasterize
+      int replayX, replayY;    // screen position of its top-left corner
+      ReplayCursor replayAt[ROBOEYES_WORKERS];  // one per render worker
+
+      // Frame buffer memory: the sprite objects are constructed in place
+      // here and draw into memory (capacity bytes per buffer), so nothing
+      // is allocated after begin() and a resize that fits reuses it
+      alignas(RoboEyesSprite) uint8_t spriteStore[2][sizeof(RoboEyesSprite)];
+      uint8_t *memory;         // buffers[0]'s pixels, buffers[1]'s follow
+      uint32_t capacity;
+      uint8_t *pixels;         // memory of the buffer being drawn, for the fill kernels
+      uint32_t stride;         // bytes per sprite row
+      bool ownsMemory;         // allocated in begin(), not caller storage
+
+      // Background layer (see setBackground()): drawn once into a buffer
+      // after the frame buffer(s); the gaps between eye spans are copied
+      // from it instead of filled with bgColor
+      const uint16_t *backgroundImage;
+      LayerDraw backgroundDraw;
+      void *backgroundArg;
+      uint8_t *layer;          // nullptr = flat bgColor
+      Rect overlayDirty[2];    // invalidated overlays still to draw into each buffer
+    };
+
+    // HUD element drawn over the eyes of a surface (see addOverlay())
+    struct Overlay {
+      uint8_t surface;
+      Rect bounds;             // frame buffer pixels
+      LayerDraw draw;
+      void *arg;
+    };
+
+    Surface surfaces[ROBOEYES_MAX_SURFACES];
+    uint8_t surfaceCount;
+    Overlay overlays[ROBOEYES_MAX_OVERLAYS];
+    uint8_t overlayCount;
+    bool fullRedraw;         // force a full clear + push on the next frame
+    bool doubleBuffered;
+
+#if ROBOEYES_STATS
+    // Ring buffer of the most recent frames' measurements
+    struct FrameRecord {
+      uint32_t renderUs, pushUs, pixels;
+      uint16_t lateMs;
+    };
+    FrameRecord statFrames[ROBOEYES_STATS_FRAMES];
+    uint16_t statHead;       // next slot to write
+    uint16_t statCount;      // valid records (up to ROBOEYES_STATS_FRAMES)
+#endif
+
+#if ROBOEYES_CACHE
+    // Expression cache: recorded frames packed in one arena (PSRAM when
+    // available), least recently used evicted first, plus an optional
+    // read-only image in flash (see loadExpressionCache())
+    struct CacheEntry {
+      uint32_t key;            // digest of the key stored in front of the frame
+      uint32_t offset;         // into cacheArena, key and frame
+      uint16_t size;
+      uint32_t lastUse;
+    };
+    CacheEntry cacheEntries[ROBOEYES_CACHE_ENTRIES];
+    uint8_t cacheCount;
+    uint8_t *cacheArena;
+    uint8_t *cacheStorage;   // caller storage for the arena, nullptr = allocated
+    uint32_t cacheBudget;    // arena size in bytes, 0 = no cache
+    uint32_t cacheUsed;
+    uint32_t cacheClock;     // lookups so far, for LRU
+    const uint8_t *cacheImage;
+    uint32_t cacheHits, cacheMisses, cacheEvictions;
+#endif
+
+#if ROBOEYES_TEXTURE
+    // Eye textures: one bitmap per layer (RGB565 or 8-bit indexed, in
+    // PROGMEM), drawn over the eye shapes bottom layer first
+    struct Texture {
+      const uint16_t *image;     // RGB565, or nullptr
+      const uint8_t *indexed;    // palette indices, or nullptr
+      const uint16_t *palette;
+      int w, h;
+      uint8_t size;              // percent of the eye
+      uint8_t follow;            // percent of the room the gaze may use
+      uint16_t transparent;      // color showing the eye (or layers) below
+    };
+    // A texture scaled to one size, RGB565 in textureArena; least
+    // recently used evicted first
+    struct TextureVariant {
+      uint8_t layer;
+      int16_t w, h;
+      uint32_t offset;           // into textureArena
+      uint32_t lastUse;
+    };
+    // Where a layer is drawn on an eye this frame
+    struct TexturePlacement {
+      int16_t x, y, w, h;        // w = 0: not drawn
+      const uint16_t *pixels;
+    };
+    Texture textures[ROBOEYES_TEXTURE_LAYERS];
+    TexturePlacement texturePlaced[ROBOEYES_MAX_EYES][ROBOEYES_TEXTURE_LAYERS];
+    TextureVariant textureVariants[ROBOEYES_TEXTURE_ENTRIES];
+    uint8_t textureVariantCount;
+    bool textured;               // some layer is placed this frame
+    uint8_t *textureArena;
+    uint8_t *textureStorage;     // caller storage for the arena, nullptr = allocated
+    uint32_t textureBudget;
+    uint32_t textureUsed;
+    uint32_t textureClock;       // lookups so far, for LRU
+    uint32_t textureHits, textureMisses;
+#endif
+
+#if ROBOEYES_MIRROR
+    // Mirror stream: frames of one surface encoded as they are pushed,
+    // through a small staging buffer (see mirrorFrame())
+    Print *mirrorOut;
+    uint8_t mirrorSurface;
+    uint16_t mirrorKeyInterval;  // frames between keyframes, 0 = on request only
+    uint16_t mirrorSinceKey;
+    uint16_t mirrorCount;        // records sent
+    bool mirrorNeedKey;
+    bool mirrorFailed;           // the sink took less than it was given
+    uint16_t mirrorPalette[15];  // colors with an index, in order of first use
+    uint8_t mirrorColors;
+    uint8_t mirrorBuffer[ROBOEYES_MIRROR_BUFFER];
+    uint8_t mirrorFill;
+    uint16_t mirrorSumA, mirrorSumB;  // Fletcher-16 of the record
+    uint32_t mirrorBytes;
+    bool mirrorSizing;           // only count what the record would take
+    uint32_t mirrorSize;
+    uint32_t mirrorDropped;      // frames the sink had no room for
+#endif
+
+    // Setter calls made while the render task runs are queued as commands
+    // and applied by the render task at the start of its next frame.
+    enum CommandOp : uint8_t {
+      CMD_WIDTH, CMD_HEIGHT, CMD_RADIUS, CMD_SPACE, CMD_MOOD, CMD_POSITION,
+      CMD_AUTOBLINKER, CMD_IDLEMODE, CMD_CURIOSITY, CMD_CYCLOPS,
+      CMD_HFLICKER, CMD_VFLICKER, CMD_COLORS, CMD_CLOSE, CMD_OPEN, CMD_BLINK,
+      CMD_CONFUSED, CMD_LAUGH, CMD_PLAY, CMD_STOP, CMD_FADE, CMD_OVERLAY,
+      CMD_BACKGROUND
+    };
+    // Setters whose last call is all that counts, grouped by the state they
+    // set (see stateSlot())
+    enum { STATE_SLOTS = 12 };
+    struct Command {
+      uint8_t op, a, b;
+      uint16_t c, d;
+      const uint8_t *clip;
+    };
+#if ROBOEYES_TASK
+    // Single-producer / single-consumer ring: only the producer moves
+    // head, only the render task moves tail.
+    Command commandQueue[ROBOEYES_QUEUE_SIZE];
+    std::atomic<uint16_t> commandHead;
+    std::atomic<uint16_t> commandTail;
+    TaskHandle_t renderTask;
+    std::atomic<bool> renderStop;  // asks the render task to exit (see stopRenderTask())
+    std::atomic<bool> renderSleeping;  // idling past the next frame interval
+    TaskHandle_t renderStopper;    // task waiting for it to exit
+    uint32_t droppedCommands;  // posted from an ISR while the queue was full
+
+    // Producer side: the last command posted per state setter, so calling a
+    // setter again with the same values (e.g. setMood() from every loop())
+    // posts nothing
+    Command postedState[STATE_SLOTS];
+    bool postedValid[STATE_SLOTS];
+
+    // Render workers (see setRenderWorkers()): the task calling update()
+    // posts a job, helper k rasterizes stripe k of it and gives done
+    struct Worker {
+      TFT_RoboEyes *owner;
+      uint8_t index;
+      TaskHandle_t task;
+      SemaphoreHandle_t done;
+    };
+    Worker workers[ROBOEYES_WORKERS];  // [0] is the calling task, unused
+    Surface *jobSurface;     // nullptr tells the helpers to exit
+    const Rect *jobRects;
+    uint8_t jobCount;
+#endif
+
+    // Static-frame detection: frames whose state matches the last one
+    // drawn are not rendered or pushed.
+    FrameState frameState;   // state of the frame being drawn
+    bool frameSkipped;       // last update() found nothing to draw
+    uint32_t skippedFrames;
+
+    // Band rendering (see setBandRendering()): the sprite only holds one
+    // horizontal band of the screen, rendered and pushed band by band.
+    uint8_t bandCount;       // 0 = full-frame sprite
+    uint8_t renderScale;     // panel pixels per frame buffer pixel, each way
+    uint8_t *frameStorage;   // caller storage for the frame buffers (see setFrameBuffer())
+    uint32_t frameStorageBytes;
+    bool ready;              // begin() set up the frame buffers
+    int rasterOriginY;       // screen row stored in sprite row 0
+    uint32_t pixelsPushed;   // pixels sent to the display in the last frame
+    uint32_t pixelsWritten;  // sprite pixels written by the last drawEyes()
+    uint8_t workerCount;     // tasks rasterizing each frame (see setRenderWorkers())
+
+    // Colors
     uint16_t bgColor;        // background color for drawing overlays
     uint16_t mainColor;      // color for the eyes
 
+    // Color fade (see fadeColors()): a gradient computed when the fade
+    // starts, stepped through by time
+    bool fading;
+    unsigned long fadeStart;
+    uint16_t fadeDuration;
+    uint16_t fadeLut[2][ROBOEYES_FADE_STEPS];  // main, background
+    bool repaintAll;         // palette changed: push the whole frame, no redraw
+
+    // Frame buffer color depth. With 1 or 4 bits the sprite stores palette
+    // indices and TFT_eSPI expands them to RGB565 line by line on push.
+    uint8_t colorDepthSetting;  // requested depth, 0 = pick automatically
+    uint8_t colorDepth;         // depth actually in use
+    uint16_t inkMain, inkBg;    // values written into the frame buffer
+    uint16_t palette[16];       // 4-bit palette: 0 = bgColor, 1 = mainColor
+
     // Frame rate control
+    // Frames run on fixed deadlines (next = previous + interval), so render
+    // and push time does not stretch the interval. Once the eyes are at
+    // rest the idle interval is used until something moves again.
     int frameInterval;       // milliseconds per frame
-    unsigned long fpsTimer;
+    int idleFrameInterval;   // milliseconds per frame at rest, 0 = same rate
+    unsigned long nextFrameTime;
+    uint32_t lateFrames;     // deadlines missed entirely (frames dropped)
+    unsigned long fpsWindowStart;
+    uint16_t fpsWindowFrames;
+    uint16_t measuredFps;
+
+    // Injected time and random sources (see setClock(), setRandomSeed())
+    unsigned long (*clockMsFn)();  // nullptr = millis()
+    unsigned long (*clockUsFn)();  // nullptr = micros(), or ms * 1000 with clockMsFn
+    uint32_t randomState;          // xorshift32 state, 0 = random()
+
+    // Gaze input (see setGaze()). The newest sample is published under a
+    // sequence number that is odd while it is being written, so updates
+    // between two frames coalesce into one and neither side ever waits.
+#if ROBOEYES_TASK
+    std::atomic<uint32_t> gazeSeq, gazeSample, gazeSampleTime;
+#else
+    uint32_t gazeSeq, gazeSample, gazeSampleTime;
+#endif
+    uint32_t gazeSeen;        // sequence number of the last sample taken
+    bool gazeActive;          // a tracker is driving the eyes
+    bool gazeSaccade;         // jump to the new target this frame
+    bool gazeFresh;           // a sample was taken this frame
+    int32_t gazeX, gazeY;     // last sample, 0..65535 across the range
+    int32_t gazeVX, gazeVY;   // smoothed velocity, 1/256 of a step per ms
+    unsigned long gazeTime;   // when the last sample was taken
+    uint16_t gazeLead;        // ms to predict ahead
+    uint32_t gazeLatency;     // ms from a sample to the push that showed it
 
     // Mood flags
     bool tired;
     bool angry;
     bool happy;
     bool curious;
-    bool cyclops;   // if true, draw a single (center) eye
-    bool eyeL_open;
-    bool eyeR_open;
-
-    // --- Eye Geometry Properties ---
-    // Left eye dimensions
-    int eyeLwidthDefault, eyeLheightDefault;
-    int eyeLwidthCurrent, eyeLheightCurrent;
-    int eyeLwidthNext, eyeLheightNext;
-    int eyeLheightOffset;
-    uint8_t eyeLborderRadiusDefault, eyeLborderRadiusCurrent, eyeLborderRadiusNext;
-
-    // Right eye dimensions – mirror of left eye
-    int eyeRwidthDefault, eyeRheightDefault;
-    int eyeRwidthCurrent, eyeRheightCurrent;
-    int eyeRwidthNext, eyeRheightNext;
-    int eyeRheightOffset;
-    uint8_t eyeRborderRadiusDefault, eyeRborderRadiusCurrent, eyeRborderRadiusNext;
-
-    // Coordinates for left eye
-    int eyeLxDefault, eyeLyDefault;
-    int eyeLx, eyeLy;
-    int eyeLxNext, eyeLyNext;
-
-    // Coordinates for right eye
-    int eyeRxDefault, eyeRyDefault;
-    int eyeRx, eyeRy;
-    int eyeRxNext, eyeRyNext;
-
-    // Both eyes: eyelid and space parameters
-    uint8_t eyelidsHeightMax;
-    uint8_t eyelidsTiredHeight, eyelidsTiredHeightNext;
-    uint8_t eyelidsAngryHeight, eyelidsAngryHeightNext;
-    uint8_t eyelidsHappyBottomOffsetMax;
-    uint8_t eyelidsHappyBottomOffset, eyelidsHappyBottomOffsetNext;
+    bool cyclops;   // if true, draw a single eye (the first one)
+
+    // --- Eye Table ---
+    // Struct-of-arrays state of every eye, updated in one loop per frame.
+    // Eyes on a surface form a row: the first one (the lead) goes where it
+    // is sent, the others follow at spaceBetween. side is the eye's place
+    // across all surfaces (-1 left, 1 right, 0 middle); it decides which
+    // setter argument applies to it and which way the lids slope.
+    struct EyeTable {
+      uint8_t count;
+      uint8_t surface[ROBOEYES_MAX_EYES];
+      int8_t side[ROBOEYES_MAX_EYES];
+      bool open[ROBOEYES_MAX_EYES];
+      // Dimensions
+      int widthDefault[ROBOEYES_MAX_EYES], heightDefault[ROBOEYES_MAX_EYES];
+      int widthCurrent[ROBOEYES_MAX_EYES], heightCurrent[ROBOEYES_MAX_EYES];
+      int widthNext[ROBOEYES_MAX_EYES], heightNext[ROBOEYES_MAX_EYES];
+      int heightOffset[ROBOEYES_MAX_EYES];
+      uint8_t radiusDefault[ROBOEYES_MAX_EYES], radiusCurrent[ROBOEYES_MAX_EYES], radiusNext[ROBOEYES_MAX_EYES];
+      // Coordinates
+      int xDefault[ROBOEYES_MAX_EYES], yDefault[ROBOEYES_MAX_EYES];
+      int x[ROBOEYES_MAX_EYES], y[ROBOEYES_MAX_EYES];
+      int xNext[ROBOEYES_MAX_EYES], yNext[ROBOEYES_MAX_EYES];
+      // Eyelids
+      uint8_t tiredHeight[ROBOEYES_MAX_EYES];
+      uint8_t angryHeight[ROBOEYES_MAX_EYES];
+      uint8_t happyOffset[ROBOEYES_MAX_EYES];
+      // Rendering
+      EyeShape shape[ROBOEYES_MAX_EYES];
+      Rect box[ROBOEYES_MAX_EYES];     // footprint drawn in the previous frame
+      Rect boxOld[ROBOEYES_MAX_EYES];  // footprint two frames ago
+    };
+    EyeTable eye;
+
+    // Space between neighbouring eyes on a surface
     int spaceBetweenDefault, spaceBetweenCurrent, spaceBetweenNext;
 
+    // --- Easing ---
+    // Every animated value moves towards its target by exponential decay
+    // over elapsed time: after easeHalfLife ms half the distance is left.
+    // State is kept in 24.8 fixed point so values land exactly on target.
+    enum EaseChannel {
+      EASE_WIDTH, EASE_HEIGHT, EASE_RADIUS, EASE_X, EASE_Y,
+      EASE_TIRED, EASE_ANGRY, EASE_HAPPY,
+      EASE_COUNT
+    };
+    int32_t easeAcc[EASE_COUNT][ROBOEYES_MAX_EYES];
+    int32_t easeSpace;
+    uint16_t easeHalfLife;        // milliseconds
+    uint16_t easeGain;            // share of the distance covered this frame (Q12)
+    unsigned long easeTimer;      // time of the last easing step
+
     // --- Animation Flags & Timers ---
     bool hFlicker;
     bool hFlickerAlternate;
@@ -112,545 +695,3517 @@ class TFT_RoboEyes {
     int idleInterval;
     int idleIntervalVariation;
     unsigned long idleAnimationTimer;
-    bool confused;
-    unsigned long confusedAnimationTimer;
-    int confusedAnimationDuration;
-    bool confusedToggle;
-    bool laugh;
-    unsigned long laughAnimationTimer;
-    int laughAnimationDuration;
-    bool laughToggle;
-
-    // --- New Blink State for AutoBlinker ---
-    bool blinkingActive;             // indicates if a blink is in progress (closed state)
-    unsigned long blinkCloseDurationTimer; // timer for how long to stay closed
-    int blinkCloseDuration = 150;    // blink closed duration in milliseconds
+
+    // --- Animation Clips ---
+    // Fixed slots, so playback never allocates
+    struct ClipSlot {
+      const uint8_t *clip;       // nullptr = free
+      unsigned long start;
+      unsigned long stopStart;   // when fading out began
+      uint16_t blendIn, blendOut;
+      uint8_t eyeMask;
+      bool stopping;
+    };
+    ClipSlot clipSlots[ROBOEYES_CLIP_SLOTS];
+    int16_t clipValue[ROBOEYES_CLIP_PARAMS][ROBOEYES_MAX_EYES];  // this frame's offsets
+
+    // Renderer entry points: drawEyesT(), rasterRowT() and rowSpans() for
+    // one RoboEyesSpec
+    typedef void (TFT_RoboEyes::*DrawEyesFn)();
+    typedef void (TFT_RoboEyes::*RasterRowFn)(Surface &, int, int, int, uint8_t);
+    typedef uint8_t (TFT_RoboEyes::*RowSpansFn)(const Surface &, int, int16_t (*)[2]);
 
     // ---------------------------
     // Constructor
     // ---------------------------
-    TFT_RoboEyes(TFT_eSPI &display, bool portrait = true, int rotations = 1) {
-      tft = &display;
-      // Sprite will be allocated in begin()
+    TFT_RoboEyes(TFT_eSPI &display, bool portrait = true, int rotations = 1)
+      : TFT_RoboEyes(display, portrait, rotations, portrait ? 135 : 240, portrait ? 240 : 135, 0,
+                     &TFT_RoboEyes::drawEyesT<RoboEyesSpec<ROBOEYES_FEATURE_ALL> >,
+                     &TFT_RoboEyes::rasterRowT<RoboEyesSpec<ROBOEYES_FEATURE_ALL> >,
+                     &TFT_RoboEyes::rowSpans<RoboEyesSpec<ROBOEYES_FEATURE_ALL> >) {
+    }
+
+  protected:
+    // For RoboEyes<>: surface 0 is w x h, the frame buffers depth bits
+    // deep (0: picked in begin()), drawn by the renderer given
+    TFT_RoboEyes(TFT_eSPI &display, bool portrait, int rotations, int w, int h, uint8_t depth,
+                 DrawEyesFn draw, RasterRowFn raster, RowSpansFn spans) {
+      drawEyesFn = draw;
+      rasterRowFn = raster;
+      rowSpansFn = spans;
+
+      // Real time and Arduino's random() until told otherwise
+      clockMsFn = nullptr;
+      clockUsFn = nullptr;
+      randomState = 0;
+
+      // No gaze input yet
+      gazeSeq = gazeSample = gazeSampleTime = 0;
+      gazeSeen = 0;
+      gazeActive = gazeSaccade = gazeFresh = false;
+      gazeX = gazeY = gazeVX = gazeVY = 0;
+      gazeTime = 0;
+      gazeLead = 40;
+      gazeLatency = 0;
 
       // Handle orientation
       if (!portrait) {
-        screenWidth = 240;
-        screenHeight = 135;
-        tft->setRotation(rotations);
+        display.setRotation(rotations);
       }
 
       // Set default colors
       bgColor = DEFAULT_BGCOLOR;
       mainColor = DEFAULT_MAINCOLOR;
+      fading = false;
+      fadeStart = 0;
+      fadeDuration = 0;
+      repaintAll = false;
 
       // Default frame rate: 50fps
       frameInterval = 1000 / 50;
-      fpsTimer = 0;
+      idleFrameInterval = 0;
+      nextFrameTime = 0;
+      lateFrames = 0;
+      fpsWindowStart = 0;
+      fpsWindowFrames = 0;
+      measuredFps = 0;
 
       // Initialize mood flags
       tired = angry = happy = curious = cyclops = false;
-      eyeL_open = eyeR_open = false;
-
-      // Initialize eye dimensions (default values, you can adjust later)
-      eyeLwidthDefault = 36;
-      eyeLheightDefault = 36;
-      eyeLwidthCurrent = eyeLwidthDefault;
-      eyeLheightCurrent = 1; // start closed
-      eyeLwidthNext = eyeLwidthDefault;
-      eyeLheightNext = eyeLheightDefault;
-      eyeLheightOffset = 0;
-      eyeLborderRadiusDefault = 8;
-      eyeLborderRadiusCurrent = eyeLborderRadiusDefault;
-      eyeLborderRadiusNext = eyeLborderRadiusDefault;
-
-      eyeRwidthDefault = eyeLwidthDefault;
-      eyeRheightDefault = eyeLheightDefault;
-      eyeRwidthCurrent = eyeRwidthDefault;
-      eyeRheightCurrent = 1; // start closed
-      eyeRwidthNext = eyeRwidthDefault;
-      eyeRheightNext = eyeRheightDefault;
-      eyeRheightOffset = 0;
-      eyeRborderRadiusDefault = 8;
-      eyeRborderRadiusCurrent = eyeRborderRadiusDefault;
-      eyeRborderRadiusNext = eyeRborderRadiusDefault;
-
-      // Calculate default positions:
+
+      // Full-frame sprite at panel resolution by default
+      bandCount = 0;
+      renderScale = 1;
+      rasterOriginY = 0;
+
+      // Frame buffers allocated in begin() unless storage is given
+      frameStorage = nullptr;
+      frameStorageBytes = 0;
+      ready = false;
+
+      // Frame buffer depth, or 0 to pick it in begin() from the colors in use
+      colorDepthSetting = depth;
+      colorDepth = 8;
+
+      // Single buffer, blocking push by default
+      doubleBuffered = false;
+
+      // The display passed here is surface 0 (sprite allocated in begin())
+      memset(&eye, 0, sizeof(eye));
       spaceBetweenDefault = 10;
       spaceBetweenCurrent = spaceBetweenDefault;
       spaceBetweenNext = spaceBetweenDefault;
-      eyeLxDefault = (screenWidth - (eyeLwidthDefault + spaceBetweenDefault + eyeRwidthDefault)) / 2;
-      eyeLyDefault = (screenHeight - eyeLheightDefault) / 2;
-      eyeLx = eyeLxDefault;
-      eyeLy = eyeLyDefault;
-      eyeLxNext = eyeLx;
-      eyeLyNext = eyeLy;
-      // Right eye
-      eyeRxDefault = eyeLxDefault + eyeLwidthDefault + spaceBetweenDefault;
-      eyeRyDefault = eyeLyDefault;
-      eyeRx = eyeRxDefault;
-      eyeRy = eyeRyDefault;
-      eyeRxNext = eyeRx;
-      eyeRyNext = eyeRy;
-
-      eyelidsHeightMax = eyeLheightDefault / 2;
-      eyelidsTiredHeight = 0;
-      eyelidsTiredHeightNext = 0;
-      eyelidsAngryHeight = 0;
-      eyelidsAngryHeightNext = 0;
-      eyelidsHappyBottomOffsetMax = (eyeLheightDefault / 2) + 3;
-      eyelidsHappyBottomOffset = 0;
-      eyelidsHappyBottomOffsetNext = 0;
+      surfaceCount = 0;
+      overlayCount = 0;
+      addSurface(display, w, h);
+
+      // Two eyes side by side on it (default values, you can adjust later)
+      eye.count = 2;
+      for (uint8_t i = 0; i < eye.count; i++) {
+        eye.surface[i] = 0;
+        eye.open[i] = false;
+        eye.widthDefault[i] = 36;
+        eye.heightDefault[i] = 36;
+        eye.widthCurrent[i] = eye.widthDefault[i];
+        eye.heightCurrent[i] = 1; // start closed
+        eye.widthNext[i] = eye.widthDefault[i];
+        eye.heightNext[i] = eye.heightDefault[i];
+        eye.radiusDefault[i] = 8;
+        eye.radiusCurrent[i] = eye.radiusDefault[i];
+        eye.radiusNext[i] = eye.radiusDefault[i];
+      }
+
+      // Calculate default positions and start there
+      relayout();
+      for (uint8_t i = 0; i < eye.count; i++) {
+        eye.x[i] = eye.xNext[i] = eye.xDefault[i];
+        eye.y[i] = eye.yNext[i] = eye.yDefault[i];
+      }
 
       // Animation defaults
       hFlicker = false; hFlickerAlternate = false; hFlickerAmplitude = 2;
       vFlicker = false; vFlickerAlternate = false; vFlickerAmplitude = 10;
       autoblinker = false; blinkInterval = 1; blinkIntervalVariation = 4; blinktimer = 0;
       idle = false; idleInterval = 1; idleIntervalVariation = 3; idleAnimationTimer = 0;
-      confused = false; confusedAnimationDuration = 500; confusedToggle = true;
-      laugh = false; laughAnimationDuration = 500; laughToggle = true;
 
-      // New auto-blink state
-      blinkingActive = false;
-      blinkCloseDurationTimer = 0;
+      // No clips playing
+      memset(clipSlots, 0, sizeof(clipSlots));
+      memset(clipValue, 0, sizeof(clipValue));
+
+      // Nothing drawn yet, first frame is a full push
+      fullRedraw = true;
+      pixelsPushed = 0;
+      pixelsWritten = 0;
+
+      // Easing: a 20 ms half-life matches the old per-frame halving at 50 fps
+      easeHalfLife = 20;
+      easeGain = 0;
+      easeTimer = 0;
+      easeSync();
+
+#if ROBOEYES_STATS
+      statHead = statCount = 0;
+#endif
+
+#if ROBOEYES_CACHE
+      cacheCount = 0;
+      cacheArena = cacheStorage = nullptr;
+      cacheBudget = cacheUsed = cacheClock = 0;
+      cacheImage = nullptr;
+      cacheHits = cacheMisses = cacheEvictions = 0;
+#endif
+
+#if ROBOEYES_TEXTURE
+      memset(textures, 0, sizeof(textures));
+      memset(texturePlaced, 0, sizeof(texturePlaced));
+      textureVariantCount = 0;
+      textured = false;
+      textureArena = textureStorage = nullptr;
+      textureBudget = ROBOEYES_TEXTURE_BYTES;
+      textureUsed = textureClock = 0;
+      textureHits = textureMisses = 0;
+#endif
+
+#if ROBOEYES_MIRROR
+      mirrorOut = nullptr;
+      mirrorSurface = 0;
+      mirrorKeyInterval = 0;
+      mirrorSinceKey = mirrorCount = 0;
+      mirrorNeedKey = true;
+      mirrorFailed = false;
+      mirrorColors = mirrorFill = 0;
+      mirrorBytes = 0;
+      mirrorSizing = false;
+      mirrorSize = mirrorDropped = 0;
+#endif
+
+#if ROBOEYES_TASK
+      commandHead.store(0);
+      commandTail.store(0);
+      renderTask = nullptr;
+      renderStop.store(false);
+      renderSleeping.store(false);
+      renderStopper = nullptr;
+      droppedCommands = 0;
+      jobSurface = nullptr;
+      jobRects = nullptr;
+      jobCount = 0;
+#endif
+      workerCount = 1;
+
+      // No frame drawn yet
+      frameSkipped = false;
+      skippedFrames = 0;
+
+      for (uint8_t i = 0; i < 16; i++) palette[i] = bgColor;
+      updateInks();
     }
 
+  public:
+
     // ---------------------------
     // Public methods
     // ---------------------------
-    // Call from setup() to set up the sprite and reset the eyes.
-    void begin(byte frameRate = 50) {
-      // Allocate and create the sprite (off-screen buffer)
-      sprite = new TFT_eSprite(tft);
-      sprite->setColorDepth(8);
-      sprite->createSprite(screenWidth, screenHeight);
-      sprite->fillSprite(bgColor);
-
-      eyeLheightCurrent = 1;
-      eyeRheightCurrent = 1;
+    // Call from setup() to set up the sprite and reset the eyes. This is
+    // the only place memory is allocated, and only for what was not given
+    // with setFrameBuffer() / setExpressionCache(). Returns false if the
+    // frame buffers do not fit (the eyes are then not drawn).
+    bool begin(byte frameRate = 50) {
+      freeBuffers();
+      if (bandCount || renderScale > 1) doubleBuffered = false;
+      colorDepth = frameDepth();
+      updateInks();
+      uint32_t offset = 0;
+      for (uint8_t s = 0; s < surfaceCount; s++) {
+        if (!allocSurface(surfaces[s], offset)) {
+          freeBuffers();
+          return false;
+        }
+      }
+      updateInks();
+#if ROBOEYES_CACHE
+      if (cacheBudget) {
+        cacheArena = cacheStorage ? cacheStorage : allocMemory(cacheBudget, true);
+        if (!cacheArena) cacheBudget = 0;
+      }
+#endif
+#if ROBOEYES_TEXTURE
+      if (textureBudget && hasTextures()) {
+        textureArena = textureStorage ? textureStorage : allocMemory(textureBudget, true);
+      }
+#endif
+      ready = true;
+
+      for (uint8_t i = 0; i < eye.count; i++) {
+        eye.heightCurrent[i] = 1;
+      }
+      easeSync();
+      easeTimer = ROBOEYES_MILLIS();
+      fullRedraw = true;
       setFramerate(frameRate);
+      nextFrameTime = fpsWindowStart = ROBOEYES_MILLIS();
+      return true;
+    }
+
+    // Undo begin(): stop the render task, let DMA finish, destroy the
+    // sprites and free what begin() allocated. Caller storage is left
+    // alone. begin() may be called again afterwards.
+    void end() {
+#if ROBOEYES_TASK
+      stopRenderTask();
+      stopWorkers();
+#endif
+      freeBuffers();
+    }
+
+    ~TFT_RoboEyes() {
+      end();
     }
 
     // Update the display; call often (e.g., inside loop())
     void update() {
-      if (millis() - fpsTimer >= frameInterval) {
-        drawEyes();                // draw on the sprite
-        sprite->pushSprite(0, 0);    // push the complete frame in one go
-        fpsTimer = millis();
+#if ROBOEYES_TASK
+      if (renderTask && xTaskGetCurrentTaskHandle() != renderTask) return;  // the task draws
+#endif
+      if (!ready) return;
+      unsigned long now = ROBOEYES_MILLIS();
+      if ((long)(now - nextFrameTime) < 0) return;
+      drainCommands();
+
+      // Missed whole intervals are dropped, not caught up in a burst.
+      // The stats get the lateness against the deadline that was missed.
+      unsigned long late = now - nextFrameTime;
+      if (late >= (unsigned long)frameInterval) {
+        unsigned long missed = late / frameInterval;
+        lateFrames += missed;
+        nextFrameTime += missed * frameInterval;
       }
-    }
 
-    // Set the target frame rate (fps)
-    void setFramerate(byte fps) {
-      frameInterval = 1000 / fps;
-    }
+      uint32_t tStart = statClock();
+      if (doubleBuffered) {
+        for (uint8_t s = 0; s < surfaceCount; s++) {
+          selectDrawBuffer(surfaces[s]);  // waits if this buffer is still in flight
+        }
+      }
+      drawEyes();                  // all eyes, rasterized into their surfaces
+      uint32_t tRendered = statClock();
+      pixelsPushed = 0;
+      for (uint8_t s = 0; s < surfaceCount; s++) {
+        Surface &sf = surfaces[s];
+        if (sf.skipped) continue;              // nothing changed on this display
+        if (bandCount) pushBands(sf);          // rasterize and push band by band
+        else if (doubleBuffered) pushDMA(sf);  // returns once the transfer is queued
+        else pushDirtyRects(sf);               // push only the regions that changed
+      }
+#if ROBOEYES_MIRROR
+      if (mirrorOut && mirrorSurface < surfaceCount) {
+        Surface &sf = surfaces[mirrorSurface];
+        if (!sf.skipped || mirrorNeedKey) mirrorFrame(sf);
+      }
+#endif
+      recordFrame(tStart, tRendered, late);
+      if (gazeFresh) {
+        gazeLatency = ROBOEYES_MILLIS() - gazeTime;
+        gazeFresh = false;
+      }
 
-    // Use this function to update the screen dimensions (e.g., when switching orientation)
-    void setScreenSize(int w, int h) {
-      screenWidth = w;
-      screenHeight = h;
-      // Recalculate default positions for centering the eyes
-      eyeLxDefault = (screenWidth - (eyeLwidthDefault + spaceBetweenDefault + eyeRwidthDefault)) / 2;
-      eyeLyDefault = (screenHeight - eyeLheightDefault) / 2;
-      eyeRxDefault = eyeLxDefault + eyeLwidthDefault + spaceBetweenDefault;
-      eyeRyDefault = eyeLyDefault;
-      // Update next positions for smooth transition
-      eyeLxNext = eyeLxDefault;
-      eyeLyNext = eyeLyDefault;
-      eyeRxNext = eyeRxDefault;
-      eyeRyNext = eyeRyDefault;
-      // Recreate sprite with new dimensions
-      if(sprite) {
-        sprite->deleteSprite();
-        sprite->createSprite(screenWidth, screenHeight);
+      // Measured frame rate over one-second windows
+      fpsWindowFrames++;
+      if (now - fpsWindowStart >= 1000) {
+        measuredFps = (uint32_t)fpsWindowFrames * 1000 / (now - fpsWindowStart);
+        fpsWindowStart = now;
+        fpsWindowFrames = 0;
       }
-    }
 
-    // Customization methods
-    void setWidth(byte leftEye, byte rightEye) {
-      eyeLwidthNext = leftEye;
-      eyeRwidthNext = rightEye;
-      eyeLwidthDefault = leftEye;
-      eyeRwidthDefault = rightEye;
+      // Schedule the next deadline: slow down while nothing moves, but
+      // never sleep past the next blink or idle move, nor while clips play
+      // or colors fade
+      nextFrameTime += frameInterval;
+      if (frameSkipped && idleFrameInterval > frameInterval && !clipsPlaying() && !fading) {
+        nextFrameTime += idleFrameInterval - frameInterval;
+        unsigned long event = nextTimerEvent(now);
+        if ((long)(event - nextFrameTime) < 0) nextFrameTime = event;
+      }
     }
 
-    void setHeight(byte leftEye, byte rightEye) {
-      eyeLheightNext = leftEye;
-      eyeRheightNext = rightEye;
-      eyeLheightDefault = leftEye;
-      eyeRheightDefault = rightEye;
+#if ROBOEYES_TASK
+    // Run update() in its own FreeRTOS task pinned to a core (0 by default,
+    // leaving core 1 to loop()). From then on the setters only queue
+    // commands, so they may be called from one other task or an ISR (one
+    // producer at a time) without tearing the frame being drawn. Calling
+    // update() from loop() becomes a no-op.
+    bool startRenderTask(uint8_t core = 0, UBaseType_t priority = 1, uint32_t stackSize = 4096) {
+      if (renderTask) return true;
+      renderStop.store(false);
+      memset(postedValid, 0, sizeof(postedValid));
+      return xTaskCreatePinnedToCore(renderTaskLoop, "RoboEyes", stackSize, this,
+                                     priority, &renderTask, core) == pdPASS;
     }
 
-    void setBorderradius(byte leftEye, byte rightEye) {
-      eyeLborderRadiusNext = leftEye;
-      eyeRborderRadiusNext = rightEye;
-      eyeLborderRadiusDefault = leftEye;
-      eyeRborderRadiusDefault = rightEye;
+    // Ask the render task to exit and wait until it has: it finishes the
+    // frame it is on, applies the commands still queued and deletes
+    // itself. Setters then apply directly again. Call from a task other
+    // than the render task, with no setter running concurrently.
+    void stopRenderTask() {
+      if (!renderTask || xTaskGetCurrentTaskHandle() == renderTask) return;
+      renderStopper = xTaskGetCurrentTaskHandle();
+      renderStop.store(true, std::memory_order_release);
+      xTaskNotifyGive(renderTask);  // in case it is sleeping
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      renderTask = nullptr;
     }
 
-    void setSpacebetween(int space) {
-      spaceBetweenNext = space;
-      spaceBetweenDefault = space;
+    // Commands dropped because an ISR found the queue full
+    uint32_t getDroppedCommands() {
+      return droppedCommands;
     }
 
-    // Set mood expression
-    void setMood(uint8_t mood) {
-      switch (mood) {
-        case TIRED:  tired = true; angry = false; happy = false; break;
-        case ANGRY:  tired = false; angry = true; happy = false; break;
-        case HAPPY:  tired = false; angry = false; happy = true; break;
-        default:     tired = false; angry = false; happy = false; break;
+    // Rasterize frames on count workers (up to ROBOEYES_WORKERS): the task
+    // calling update() plus count - 1 helper tasks, e.g. 2 to put both
+    // ESP32 cores on the eyes. The eye geometry is still worked out once
+    // per frame; the rows of the dirty regions are then cut into count
+    // horizontal stripes rendered side by side, and the frame is pushed
+    // once all of them are done. Helpers run on any free core unless core
+    // is given. 1 stops them. Call before startRenderTask(), not from an ISR.
+    bool setRenderWorkers(uint8_t count, BaseType_t core = tskNO_AFFINITY,
+                          UBaseType_t priority = 1, uint32_t stackSize = 2048) {
+      stopWorkers();
+      if (count < 1) count = 1;
+      if (count > ROBOEYES_WORKERS) count = ROBOEYES_WORKERS;
+      for (uint8_t k = 1; k < count; k++) {
+        Worker &wk = workers[k];
+        wk.owner = this;
+        wk.index = k;
+        wk.done = xSemaphoreCreateBinary();
+        if (!wk.done) break;
+        if (xTaskCreatePinnedToCore(workerTaskLoop, "RoboEyesRaster", stackSize, &wk,
+                                    priority, &wk.task, core) != pdPASS) {
+          vSemaphoreDelete(wk.done);
+          break;
+        }
+        workerCount = k + 1;
       }
+      if (workerCount == count) return true;
+      stopWorkers();
+      return false;
     }
+#endif
 
-    // Predefined position for left eye (affects both eyes)
-    void setPosition(uint8_t position) {
-      switch (position) {
-        case N:
-          eyeLxNext = getScreenConstraint_X() / 2;
-          eyeLyNext = 0;
-          break;
-        case NE:
-          eyeLxNext = getScreenConstraint_X();
-          eyeLyNext = 0;
-          break;
-        case E:
-          eyeLxNext = getScreenConstraint_X();
-          eyeLyNext = getScreenConstraint_Y() / 2;
-          break;
-        case SE:
-          eyeLxNext = getScreenConstraint_X();
-          eyeLyNext = getScreenConstraint_Y();
-          break;
-        case S:
-          eyeLxNext = getScreenConstraint_X() / 2;
-          eyeLyNext = getScreenConstraint_Y();
-          break;
-        case SW:
-          eyeLxNext = 0;
-          eyeLyNext = getScreenConstraint_Y();
-          break;
-        case W:
-          eyeLxNext = 0;
-          eyeLyNext = getScreenConstraint_Y() / 2;
-          break;
-        case NW:
-          eyeLxNext = 0;
-          eyeLyNext = 0;
-          break;
-        default:
-          // DEFAULT (center): use the preset default positions.
-          eyeLxNext = eyeLxDefault;
-          eyeLyNext = eyeLyDefault;
-          break;
-      }
+    uint8_t getRenderWorkers() {
+      return workerCount;
     }
 
-    // Set auto blink feature (in seconds)
-    void setAutoblinker(bool active, int interval = 1, int variation = 4) {
-      autoblinker = active;
-      blinkInterval = interval;
-      blinkIntervalVariation = variation;
-      // Reset blink timers and state when enabling
-      blinktimer = millis() + (blinkInterval * 1000UL) + (random(blinkIntervalVariation) * 1000UL);
-      blinkingActive = false;
+    // Run the eyes on another clock, e.g. a simulated one that a headless
+    // driver advances by one frame interval per update() to render faster
+    // than real time. us defaults to ms * 1000. Pass nullptr to go back to
+    // millis()/micros(). Call before begin().
+    void setClock(unsigned long (*ms)(), unsigned long (*us)() = nullptr) {
+      clockMsFn = ms;
+      clockUsFn = us;
     }
 
-    // Set idle mode (random repositioning)
-    void setIdleMode(bool active, int interval = 1, int variation = 3) {
-      idle = active;
-      idleInterval = interval;
-      idleIntervalVariation = variation;
+    // Draw blink intervals and idle moves from a generator of its own, so
+    // the same seed and clock always give the same frames. 0 goes back to
+    // random().
+    void setRandomSeed(uint32_t seed) {
+      randomState = seed;
     }
 
-    // Enable or disable curious mode
-    void setCuriosity(bool curiousBit) {
-      curious = curiousBit;
+    // Set the target frame rate (fps) while the eyes are moving
+    void setFramerate(byte fps) {
+      frameInterval = 1000 / fps;
     }
 
-    // Enable or disable cyclops mode
-    void setCyclops(bool cyclopsBit) {
-      cyclops = cyclopsBit;
+    // Frame rate once all animations have settled (e.g. 5 fps to save CPU
+    // and power during a still stare). Any setter that changes the eyes
+    // brings the full frame rate back at once. 0 = no separate idle rate.
+    void setIdleFramerate(byte fps) {
+      idleFrameInterval = fps ? 1000 / fps : 0;
     }
 
-    // Horizontal flickering
-    void setHFlicker(bool flickerBit, uint8_t amplitude = 2) {
-      hFlicker = flickerBit;
-      hFlickerAmplitude = amplitude;
+    // Min/avg/p99/max of render time, push time, pixels pushed and
+    // lateness over the last ROBOEYES_STATS_FRAMES frames. In band mode
+    // rasterization happens during the push and is counted there.
+    RoboEyesStats getStats() {
+      RoboEyesStats stats;
+      memset(&stats, 0, sizeof(stats));
+#if ROBOEYES_STATS
+      stats.frames = statCount;
+      uint32_t values[ROBOEYES_STATS_FRAMES];
+      for (uint8_t field = 0; field < 4; field++) {
+        for (uint16_t i = 0; i < statCount; i++) {
+          const FrameRecord &r = statFrames[i];
+          values[i] = field == 0 ? r.renderUs : field == 1 ? r.pushUs : field == 2 ? r.pixels : r.lateMs;
+        }
+        RoboEyesStat &out = field == 0 ? stats.renderUs : field == 1 ? stats.pushUs
+                          : field == 2 ? stats.pixels : stats.lateMs;
+        summarize(values, statCount, out);
+      }
+#endif
+      return stats;
     }
-    void setHFlicker(bool flickerBit) {
-      hFlicker = flickerBit;
+
+    // Print the statistics as a small table, e.g. dumpStats(Serial)
+    void dumpStats(Print &out) {
+      RoboEyesStats stats = getStats();
+      out.print("RoboEyes stats over ");
+      out.print(stats.frames);
+      out.println(" frames (min / avg / p99 / max)");
+      printStat(out, "render us", stats.renderUs);
+      printStat(out, "push us  ", stats.pushUs);
+      printStat(out, "pixels   ", stats.pixels);
+      printStat(out, "late ms  ", stats.lateMs);
+      out.print("fps ");
+      out.print(measuredFps);
+      out.print(", late frames ");
+      out.print(lateFrames);
+      out.print(", skipped ");
+      out.println(skippedFrames);
     }
 
-    // Vertical flickering
-    void setVFlicker(bool flickerBit, uint8_t amplitude = 10) {
-      vFlicker = flickerBit;
-      vFlickerAmplitude = amplitude;
+    // Frames per second actually run over the last second
+    uint16_t getMeasuredFps() {
+      return measuredFps;
     }
-    void setVFlicker(bool flickerBit) {
-      vFlicker = flickerBit;
+
+    // Number of frame deadlines missed entirely because update() was
+    // called too late (those frames are dropped)
+    uint32_t getLateFrames() {
+      return lateFrames;
     }
 
-    // Set custom colors for drawing
-    void setColors(uint16_t main, uint16_t background) {
-      mainColor = main;
-      bgColor = background;
+    // Set how quickly animations settle: the time (ms) it takes any eased
+    // value to cover half the remaining distance to its target. Animation
+    // speed does not depend on the frame rate.
+    void setEaseHalfLife(uint16_t ms) {
+      easeHalfLife = ms > 0 ? ms : 1;
     }
 
-    // ---------------------------
-    // Getters for screen constraints
-    int getScreenConstraint_X() {
-      return screenWidth - eyeLwidthCurrent - spaceBetweenCurrent - eyeRwidthCurrent;
+    // Render into two buffers and push them by DMA, so drawing the next
+    // frame overlaps sending the current one. Call before begin().
+    // Costs two 16-bit frame buffers (2 x 64 KB on a 240x135 panel).
+    void setDoubleBuffered(bool active) {
+      doubleBuffered = active && bandCount == 0 && renderScale == 1;
     }
-    int getScreenConstraint_Y() {
-      return screenHeight - eyeLheightDefault;
+
+    // Frame buffer color depth in bits: 1, 4, 8 or 16, or 0 (default) to
+    // use the smallest depth that holds all colors in use. The eyes only
+    // use mainColor and bgColor, so automatic mode picks a 1-bit buffer
+    // (240x135: 4 KB instead of 32 KB at 8 bits). Call before begin().
+    void setColorDepth(uint8_t bits) {
+      colorDepthSetting = (bits == 1 || bits == 4 || bits == 8 || bits == 16) ? bits : 0;
     }
 
-    // ---------------------------
-    // Basic animation methods with modified close/open behavior
-    void close() {
-      eyeLheightNext = 1;
-      eyeRheightNext = 1;
-      eyeL_open = false;
-      eyeR_open = false;
-      eyeLborderRadiusNext = 0;
-      eyeRborderRadiusNext = 0;
+    // Bytes of frame buffer memory for the eyes (all surfaces): what
+    // begin() allocated, or will need from setFrameBuffer() once size,
+    // depth, bands, scale and double buffering are set. Each buffer has
+    // room for both orientations, so a rotation never reallocates.
+    uint32_t getFramebufferBytes() {
+      uint8_t depth = ready ? colorDepth : frameDepth();
+      uint32_t total = 0;
+      for (uint8_t s = 0; s < surfaceCount; s++) {
+        const Surface &sf = surfaces[s];
+        uint32_t capacity = ready ? sf.capacity : bufferCapacity(sf.width, sf.height, depth);
+        total += capacity * bufferCount(sf);
+      }
+      return total;
     }
-    void open() {
-      eyeL_open = true;
-      eyeR_open = true;
-      eyeLheightNext = eyeLheightDefault;
-      eyeRheightNext = eyeRheightDefault;
-      eyeLborderRadiusNext = eyeLborderRadiusDefault;
-      eyeRborderRadiusNext = eyeRborderRadiusDefault;
+
+    // Draw into caller storage - a static array, a PSRAM block, part of an
+    // arena - instead of allocating the frame buffers in begin(). bytes
+    // must be at least getFramebufferBytes(); with double buffering the
+    // storage must be DMA capable (internal RAM). The storage must stay
+    // valid until end(). nullptr goes back to allocating. Call before begin().
+    void setFrameBuffer(void *storage, uint32_t bytes) {
+      frameStorage = (uint8_t *)storage;
+      frameStorageBytes = storage ? bytes : 0;
     }
-    void blink(bool left = true, bool right = true) {
-      close();
-      open();
+
+    // Render the screen in horizontal bands through a sprite of only
+    // screenHeight / bands rows, so no full-frame buffer is allocated and
+    // peak RAM no longer grows with panel height. Bands the eyes did not
+    // touch are skipped. 0 turns band rendering off. Call before begin();
+    // takes precedence over setDoubleBuffered().
+    void setBandRendering(uint8_t bands) {
+      bandCount = bands;
+      if (bandCount) doubleBuffered = false;
     }
-    void close(bool left, bool right) {
-      if (left) { 
-        eyeLheightNext = 1; 
-        eyeL_open = false; 
-        eyeLborderRadiusNext = 0;
-      }
-      if (right){ 
-        eyeRheightNext = 1; 
-        eyeR_open = false;
-        eyeRborderRadiusNext = 0;
-      }
+
+#if ROBOEYES_CACHE
+    // Keep up to bytes of recorded frames (in PSRAM when the board has it)
+    // so expressions that repeat - blinks, mood changes, moves at a steady
+    // size - are decoded from run-length encoded rows instead of being
+    // rasterized again. Frames are keyed by the eyes' shapes relative to
+    // their position, so they replay anywhere on screen. 0 (default) turns
+    // the cache off. The arena is allocated in begin() unless storage
+    // (bytes long, valid until end()) is given. Call before begin().
+    void setExpressionCache(uint32_t bytes, void *storage = nullptr) {
+      cacheBudget = bytes;
+      cacheStorage = (uint8_t *)storage;
     }
-    void open(bool left, bool right) {
-      if (left) { 
-        eyeL_open = true; 
-        eyeLheightNext = eyeLheightDefault;
-        eyeLborderRadiusNext = eyeLborderRadiusDefault;
-      }
-      if (right){ 
-        eyeR_open = true;
-        eyeRheightNext = eyeRheightDefault;
-        eyeRborderRadiusNext = eyeRborderRadiusDefault;
+
+    // Add the frames of an image printed by dumpExpressionCache(), e.g.
+    // kept in PROGMEM, as read-only entries that are never evicted. The
+    // image is read in place and must stay valid.
+    bool loadExpressionCache(const uint8_t *image) {
+      if (!image || pgm_read_byte(image) != 'R' || pgm_read_byte(image + 1) != 'C'
+          || pgm_read_byte(image + 2) != ROBOEYES_CACHE_VERSION) return false;
+      cacheImage = image;
+      return true;
+    }
+
+    // Print the frames recorded so far as a C array for
+    // loadExpressionCache(), e.g. after playing each expression once
+    void dumpExpressionCache(Print &out) {
+      static const char hex[] = "0123456789ABCDEF";
+      uint8_t head[6] = {'R', 'C', ROBOEYES_CACHE_VERSION, 0, cacheCount, 0};
+      out.println("static const uint8_t roboEyesCache[] PROGMEM = {");
+      for (int i = -1; i < cacheCount; i++) {
+        uint8_t entry[6];
+        const uint8_t *bytes = head;
+        uint32_t size = sizeof(head);
+        if (i >= 0) {
+          const CacheEntry &e = cacheEntries[i];
+          for (uint8_t b = 0; b < 4; b++) entry[b] = e.key >> (b * 8);
+          entry[4] = e.size;
+          entry[5] = e.size >> 8;
+          bytes = entry;
+          size = sizeof(entry) + e.size;
+        }
+        for (uint32_t b = 0; b < size; b++) {
+          uint8_t v = b < 6 ? bytes[b] : cacheArena[cacheEntries[i].offset + b - 6];
+          out.print(b % 16 ? " 0x" : "  0x");
+          out.print(hex[v >> 4]);
+          out.print(hex[v & 15]);
+          out.print(',');
+          if (b % 16 == 15 || b == size - 1) out.println();
+        }
       }
+      out.println("};");
     }
 
-    void anim_confused() {
-      confused = true;
+    // Frames replayed from / missing from the expression cache
+    uint32_t getCacheHits() {
+      return cacheHits;
     }
-    void anim_laugh() {
-      laugh = true;
+    uint32_t getCacheMisses() {
+      return cacheMisses;
+    }
+    uint32_t getCacheEvictions() {
+      return cacheEvictions;
     }
 
-  private:
-    // ---------------------------
-    // Core drawing logic – adapts animations and draws the eyes on the sprite.
-    void drawEyes() {
-      // --- PRE-CALCULATIONS ---
-      if (curious) {
-        if (eyeLxNext <= 10) { eyeLheightOffset = 8; }
-        else if (eyeLxNext >= (getScreenConstraint_X() - 10) && cyclops) { eyeLheightOffset = 8; }
-        else { eyeLheightOffset = 0; }
-        if (eyeRxNext >= screenWidth - eyeRwidthCurrent - 10) { eyeRheightOffset = 8; }
-        else { eyeRheightOffset = 0; }
-      } else {
-        eyeLheightOffset = 0;
-        eyeRheightOffset = 0;
-      }
+    // Bytes of the expression cache in use
+    uint32_t getCacheBytes() {
+      return cacheUsed;
+    }
+#endif
 
-      // Smooth eye height transition
-      eyeLheightCurrent = (eyeLheightCurrent + eyeLheightNext + eyeLheightOffset) / 2;
-      eyeLy += ((eyeLheightDefault - eyeLheightCurrent) / 2);
-      eyeLy -= eyeLheightOffset / 2;
+#if ROBOEYES_TEXTURE
+    // Draw an RGB565 bitmap (PROGMEM, w x h) on every eye as texture layer
+    // 0 (iris), 1 (pupil) or 2 (highlight); higher layers are drawn over
+    // lower ones. It is scaled to size percent of the open eye, keeping
+    // its aspect ratio, and moves off center with the gaze by follow
+    // percent of the room left around it. The eye outline and lids clip
+    // it, and pixels of the transparent color show what is below.
+    // Textures need an 8- or 16-bit frame buffer; unless setColorDepth()
+    // says otherwise, begin() picks 16 bits. nullptr removes the layer.
+    // Call before begin().
+    void setEyeTexture(uint8_t layer, const uint16_t *image, int w, int h,
+                       uint8_t size = 60, uint8_t follow = 100, uint16_t transparent = TFT_BLACK) {
+      if (layer >= ROBOEYES_TEXTURE_LAYERS) return;
+      textures[layer] = Texture{image, nullptr, nullptr, w, h, size, follow, transparent};
+    }
 
-      eyeRheightCurrent = (eyeRheightCurrent + eyeRheightNext + eyeRheightOffset) / 2;
-      eyeRy += ((eyeRheightDefault - eyeRheightCurrent) / 2);
-      eyeRy -= eyeRheightOffset / 2;
+    // Same with an 8-bit indexed bitmap and its RGB565 palette (both
+    // PROGMEM); index transparentIndex is transparent
+    void setEyeTexture(uint8_t layer, const uint8_t *image, const uint16_t *palette, int w, int h,
+                       uint8_t size = 60, uint8_t follow = 100, uint8_t transparentIndex = 0) {
+      if (layer >= ROBOEYES_TEXTURE_LAYERS) return;
+      uint16_t transparent = palette ? pgm_read_word(palette + transparentIndex) : 0;
+      textures[layer] = Texture{nullptr, image, palette, w, h, size, follow, transparent};
+    }
 
-      if (eyeL_open) {
-        if (eyeLheightCurrent <= 1 + eyeLheightOffset) { eyeLheightNext = eyeLheightDefault; }
-      }
-      if (eyeR_open) {
-        if (eyeRheightCurrent <= 1 + eyeRheightOffset) { eyeRheightNext = eyeRheightDefault; }
+    // Keep up to bytes of scaled texture variants (default
+    // ROBOEYES_TEXTURE_BYTES, in PSRAM when the board has it). Eye sizes
+    // animate every frame, so each texture is scaled once per size step
+    // and the variants are shared by all eyes. The arena is allocated in
+    // begin() unless storage (bytes long, valid until end()) is given.
+    // Call before begin().
+    void setTextureCache(uint32_t bytes, void *storage = nullptr) {
+      textureBudget = bytes;
+      textureStorage = (uint8_t *)storage;
+    }
+
+    // Texture variants found in / scaled into the cache
+    uint32_t getTextureHits() {
+      return textureHits;
+    }
+    uint32_t getTextureMisses() {
+      return textureMisses;
+    }
+
+    // Bytes of the texture cache in use
+    uint32_t getTextureBytes() {
+      return textureUsed;
+    }
+#endif
+
+    // Render at 1/factor of the panel resolution (1, 2 or 4) and send each
+    // frame buffer pixel as a factor x factor block. The eyes are flat
+    // shapes, so they look the same but the frame buffer is factor^2
+    // times smaller and so is the fill work. The enlarged pixels are
+    // streamed to the panel as runs, with no full-size buffer. Call before
+    // begin(); turns DMA double buffering off (it needs a full-size image).
+    void setRenderScale(uint8_t factor) {
+      renderScale = (factor == 2 || factor == 4) ? factor : 1;
+      if (renderScale > 1) doubleBuffered = false;
+    }
+
+    // Use this function to update the screen dimensions (e.g., when
+    // switching orientation). The frame buffers are reused when the new
+    // size fits; returns false, keeping the old size, if it does not and
+    // they cannot grow (caller storage or out of memory).
+    bool setScreenSize(int w, int h) {
+      return resizeSurface(surfaces[0], w, h);
+    }
+
+    // ---------------------------
+    // Multiple eyes and displays
+
+    // Add another display of w x h pixels for the eyes to be drawn on.
+    // Returns its surface index, or -1 if ROBOEYES_MAX_SURFACES are in use.
+    // Bind eyes to it with addEye() or bindEye(). Call before begin().
+    int8_t addSurface(TFT_eSPI &display, int w, int h) {
+      if (surfaceCount >= ROBOEYES_MAX_SURFACES) return -1;
+      Surface &sf = surfaces[surfaceCount];
+      memset(&sf, 0, sizeof(sf));
+      sf.tft = &display;
+      sf.width = w;
+      sf.height = h;
+      sf.bufferStale[0] = sf.bufferStale[1] = true;
+      surfaceCount++;
+      relayout();
+      return surfaceCount - 1;
+    }
+
+    // Add an eye at the right end of a surface's row, sized like the first
+    // eye. Returns its index, or -1 if ROBOEYES_MAX_EYES are in use.
+    // Call before begin().
+    int8_t addEye(uint8_t surface) {
+      if (eye.count >= ROBOEYES_MAX_EYES || surface >= surfaceCount) return -1;
+      uint8_t i = eye.count++;
+      eye.surface[i] = surface;
+      eye.open[i] = eye.open[0];
+      eye.widthDefault[i] = eye.widthNext[i] = eye.widthCurrent[i] = eye.widthDefault[0];
+      eye.heightDefault[i] = eye.heightNext[i] = eye.heightDefault[0];
+      eye.heightCurrent[i] = 1;
+      eye.radiusDefault[i] = eye.radiusNext[i] = eye.radiusCurrent[i] = eye.radiusDefault[0];
+      relayout();
+      eye.x[i] = eye.xNext[i] = eye.xDefault[i];
+      eye.y[i] = eye.yNext[i] = eye.yDefault[i];
+      easeSync();
+      return i;
+    }
+
+    // Move an eye to another surface, e.g. bindEye(1, addSurface(...)) puts
+    // the right eye on a second panel. Call before begin().
+    void bindEye(uint8_t index, uint8_t surface) {
+      if (index >= eye.count || surface >= surfaceCount) return;
+      eye.surface[index] = surface;
+      relayout();
+      for (uint8_t i = 0; i < eye.count; i++) {
+        eye.xNext[i] = eye.xDefault[i];
+        eye.yNext[i] = eye.yDefault[i];
+      }
+      fullRedraw = true;
+    }
+
+    uint8_t getEyeCount() {
+      return eye.count;
+    }
+
+    uint8_t getSurfaceCount() {
+      return surfaceCount;
+    }
+
+    // ---------------------------
+    // Layers
+    // Behind the eyes, a background layer per surface is drawn once and
+    // kept in a buffer of its own, so a frame only copies it back under
+    // the eyes' old and new footprint. Over them, overlays (HUD elements)
+    // are only drawn again where the eyes passed or when invalidated.
+    // Layers need a full frame buffer (not with setBandRendering()) and
+    // use frame buffer coordinates (panel pixels / render scale). Unless
+    // setColorDepth() says otherwise, they make begin() pick 16 bits.
+
+    // Background from an RGB565 image the size of the panel (PROGMEM,
+    // read when the layer is drawn). nullptr goes back to a flat bgColor.
+    // Call before begin().
+    void setBackground(uint8_t surface, const uint16_t *image) {
+      if (surface >= surfaceCount) return;
+      surfaces[surface].backgroundImage = image;
+      surfaces[surface].backgroundDraw = nullptr;
+    }
+
+    // Background drawn by draw(sprite, arg) on a sprite cleared to
+    // bgColor, e.g. a face plate. Call before begin().
+    void setBackground(uint8_t surface, LayerDraw draw, void *arg = nullptr) {
+      if (surface >= surfaceCount) return;
+      surfaces[surface].backgroundImage = nullptr;
+      surfaces[surface].backgroundDraw = draw;
+      surfaces[surface].backgroundArg = arg;
+    }
+
+    // Draw a surface's background layer again, and the frame over it
+    void invalidateBackground(uint8_t surface) {
+      if (deferred(CMD_BACKGROUND, surface)) return;
+      if (surface >= surfaceCount || !surfaces[surface].layer) return;
+      drawBackground(surfaces[surface]);
+      fullRedraw = true;
+      wake();
+    }
+
+    // Add an overlay covering w x h pixels at x, y of a surface, drawn by
+    // draw(sprite, arg) over the eyes with the sprite clipped to what
+    // needs drawing. Returns its index, or -1 if ROBOEYES_MAX_OVERLAYS are
+    // in use. Call before begin().
+    int8_t addOverlay(uint8_t surface, int x, int y, int w, int h, LayerDraw draw, void *arg = nullptr) {
+      if (overlayCount >= ROBOEYES_MAX_OVERLAYS || surface >= surfaceCount || !draw) return -1;
+      overlays[overlayCount] = Overlay{surface, Rect{x, y, w, h}, draw, arg};
+      return overlayCount++;
+    }
+
+    // Draw an overlay again on the next frame, e.g. after its text
+    // changed. Overlays nobody invalidates cost nothing while the eyes
+    // stay clear of them.
+    void invalidateOverlay(uint8_t index) {
+      if (deferred(CMD_OVERLAY, index)) return;
+      if (index >= overlayCount) return;
+      const Overlay &o = overlays[index];
+      Surface &sf = surfaces[o.surface];
+      sf.overlayDirty[0] = unionRect(sf.overlayDirty[0], o.bounds);
+      sf.overlayDirty[1] = unionRect(sf.overlayDirty[1], o.bounds);
+      wake();
+    }
+
+    // ---------------------------
+    // Customization methods
+    // With more than two eyes, leftEye applies to the eyes on the left half
+    // (and the middle one) and rightEye to those on the right half.
+    void setWidth(byte leftEye, byte rightEye) {
+      if (deferred(CMD_WIDTH, leftEye, rightEye)) return;
+      for (uint8_t i = 0; i < eye.count; i++) {
+        eye.widthNext[i] = eye.widthDefault[i] = eye.side[i] > 0 ? rightEye : leftEye;
+      }
+      wake();
+    }
+
+    void setHeight(byte leftEye, byte rightEye) {
+      if (deferred(CMD_HEIGHT, leftEye, rightEye)) return;
+      for (uint8_t i = 0; i < eye.count; i++) {
+        eye.heightNext[i] = eye.heightDefault[i] = eye.side[i] > 0 ? rightEye : leftEye;
+      }
+      wake();
+    }
+
+    void setBorderradius(byte leftEye, byte rightEye) {
+      if (deferred(CMD_RADIUS, leftEye, rightEye)) return;
+      for (uint8_t i = 0; i < eye.count; i++) {
+        eye.radiusNext[i] = eye.radiusDefault[i] = eye.side[i] > 0 ? rightEye : leftEye;
+      }
+      wake();
+    }
+
+    void setSpacebetween(int space) {
+      if (deferred(CMD_SPACE, 0, 0, (uint16_t)space)) return;
+      spaceBetweenNext = space;
+      spaceBetweenDefault = space;
+      wake();
+    }
+
+    // Set mood expression
+    void setMood(uint8_t mood) {
+      if (deferred(CMD_MOOD, mood)) return;
+      bool wasTired = tired, wasAngry = angry, wasHappy = happy;
+      switch (mood) {
+        case TIRED:  tired = true; angry = false; happy = false; break;
+        case ANGRY:  tired = false; angry = true; happy = false; break;
+        case HAPPY:  tired = false; angry = false; happy = true; break;
+        default:     tired = false; angry = false; happy = false; break;
+      }
+      if (tired != wasTired || angry != wasAngry || happy != wasHappy) wake();
+    }
+
+    // Predefined position for the eyes: moves the first eye of every
+    // surface, the others follow it
+    void setPosition(uint8_t position) {
+      if (deferred(CMD_POSITION, position)) return;
+      bool moved;
+      switch (position) {
+        case N:  moved = aimLeads(1, 2, 0, 1); break;
+        case NE: moved = aimLeads(1, 1, 0, 1); break;
+        case E:  moved = aimLeads(1, 1, 1, 2); break;
+        case SE: moved = aimLeads(1, 1, 1, 1); break;
+        case S:  moved = aimLeads(1, 2, 1, 1); break;
+        case SW: moved = aimLeads(0, 1, 1, 1); break;
+        case W:  moved = aimLeads(0, 1, 1, 2); break;
+        case NW: moved = aimLeads(0, 1, 0, 1); break;
+        default:
+          // DEFAULT (center): use the preset default positions.
+          moved = false;
+          for (uint8_t s = 0; s < surfaceCount; s++) {
+            if (surfaces[s].eyeCount == 0) continue;
+            uint8_t i = surfaces[s].eyes[0];
+            moved |= eye.xNext[i] != eye.xDefault[i] || eye.yNext[i] != eye.yDefault[i];
+            eye.xNext[i] = eye.xDefault[i];
+            eye.yNext[i] = eye.yDefault[i];
+          }
+          break;
+      }
+      if (moved) wake();
+    }
+
+    // Look at a point in normalized coordinates: (0, 0) is the top left of
+    // the range the eyes can move in (see getScreenConstraint_X/Y), (1, 1)
+    // the bottom right and (0.5, 0.5) the center. Meant to be fed by a face
+    // or object tracker at any rate: calls between two frames coalesce into
+    // one target, small moves are followed smoothly and predicted ahead
+    // (see setGazePrediction()), large jumps are made at once, like a
+    // saccade. Safe to call from another task or an ISR while the render
+    // task runs. After ROBOEYES_GAZE_TIMEOUT ms without input, idle mode
+    // (if on) takes over again.
+    void setGaze(float nx, float ny) {
+      nx = nx < 0 ? 0 : (nx > 1 ? 1 : nx);
+      ny = ny < 0 ? 0 : (ny > 1 ? 1 : ny);
+      uint32_t seq = gazeSeq;
+      gazeSeq = seq + 1;
+      gazeSample = ((uint32_t)(nx * 65535 + 0.5f) << 16) | (uint32_t)(ny * 65535 + 0.5f);
+      gazeSampleTime = ROBOEYES_MILLIS();
+      gazeSeq = seq + 2;
+#if ROBOEYES_TASK
+      if (renderTask && (xPortInIsrContext() || xTaskGetCurrentTaskHandle() != renderTask)) {
+        if (renderSleeping.load(std::memory_order_relaxed)) notifyRenderTask();
+        return;
+      }
+#endif
+      wake();
+    }
+
+    // How far ahead (ms) to extrapolate the gaze from its recent velocity,
+    // to make up for tracker and display latency. 0 = no prediction.
+    void setGazePrediction(uint16_t ms) {
+      gazeLead = ms;
+    }
+
+    // Milliseconds from the last gaze sample taken to the end of the push
+    // that showed it
+    uint32_t getGazeLatency() {
+      return gazeLatency;
+    }
+
+    // Set auto blink feature (in seconds)
+    void setAutoblinker(bool active, int interval = 1, int variation = 4) {
+      if (deferred(CMD_AUTOBLINKER, active, 0, interval, variation)) return;
+      autoblinker = active;
+      blinkInterval = interval;
+      blinkIntervalVariation = variation;
+      // Reset blink timers and state when enabling
+      blinktimer = ROBOEYES_MILLIS() + (blinkInterval * 1000UL) + (ROBOEYES_RANDOM(blinkIntervalVariation) * 1000UL);
+      wake();
+    }
+
+    // Set idle mode (random repositioning)
+    void setIdleMode(bool active, int interval = 1, int variation = 3) {
+      if (deferred(CMD_IDLEMODE, active, 0, interval, variation)) return;
+      idle = active;
+      idleInterval = interval;
+      idleIntervalVariation = variation;
+      wake();
+    }
+
+    // Enable or disable curious mode
+    void setCuriosity(bool curiousBit) {
+      if (deferred(CMD_CURIOSITY, curiousBit)) return;
+      curious = curiousBit;
+      wake();
+    }
+
+    // Enable or disable cyclops mode
+    void setCyclops(bool cyclopsBit) {
+      if (deferred(CMD_CYCLOPS, cyclopsBit)) return;
+      cyclops = cyclopsBit;
+      wake();
+    }
+
+    // Horizontal flickering
+    void setHFlicker(bool flickerBit, uint8_t amplitude = 2) {
+      if (deferred(CMD_HFLICKER, flickerBit | 2, amplitude)) return;
+      hFlicker = flickerBit;
+      hFlickerAmplitude = amplitude;
+      wake();
+    }
+    void setHFlicker(bool flickerBit) {
+      if (deferred(CMD_HFLICKER, flickerBit)) return;
+      hFlicker = flickerBit;
+      wake();
+    }
+
+    // Vertical flickering
+    void setVFlicker(bool flickerBit, uint8_t amplitude = 10) {
+      if (deferred(CMD_VFLICKER, flickerBit | 2, amplitude)) return;
+      vFlicker = flickerBit;
+      vFlickerAmplitude = amplitude;
+      wake();
+    }
+    void setVFlicker(bool flickerBit) {
+      if (deferred(CMD_VFLICKER, flickerBit)) return;
+      vFlicker = flickerBit;
+      wake();
+    }
+
+    // Set custom colors for drawing
+    void setColors(uint16_t main, uint16_t background) {
+      if (deferred(CMD_COLORS, 0, 0, main, background)) return;
+      fading = false;
+      applyColors(main, background);
+    }
+
+    // Fade to new colors over ms milliseconds. With a 1- or 4-bit frame
+    // buffer only the palette changes: the frame is sent again but not
+    // redrawn. Calling it again with the colors already shown or being
+    // faded to costs nothing, so it can be called from every loop().
+    void fadeColors(uint16_t main, uint16_t background, uint16_t ms) {
+      if (deferred(CMD_FADE, ms & 0xFF, ms >> 8, main, background)) return;
+      const uint8_t last = ROBOEYES_FADE_STEPS - 1;
+      uint16_t toMain = fading ? fadeLut[0][last] : mainColor;
+      uint16_t toBg = fading ? fadeLut[1][last] : bgColor;
+      if (main == toMain && background == toBg) return;
+      if (ms == 0) {
+        setColors(main, background);
+        return;
+      }
+      for (uint8_t i = 0; i <= last; i++) {
+        fadeLut[0][i] = blend565(mainColor, main, i + 1, ROBOEYES_FADE_STEPS);
+        fadeLut[1][i] = blend565(bgColor, background, i + 1, ROBOEYES_FADE_STEPS);
+      }
+      fadeStart = ROBOEYES_MILLIS();
+      fadeDuration = ms;
+      fading = true;
+      wake();
+    }
+
+    // ---------------------------
+    // Getters for screen constraints: the range the first eye of a surface
+    // can be moved in while the whole row stays on screen
+    int getScreenConstraint_X(uint8_t surface = 0) {
+      const Surface &sf = surfaces[surface];
+      int room = sf.width;
+      for (uint8_t k = 0; k < sf.eyeCount; k++) {
+        room -= eye.widthCurrent[sf.eyes[k]] + (k ? spaceBetweenCurrent : 0);
+      }
+      return room;
+    }
+    int getScreenConstraint_Y(uint8_t surface = 0) {
+      const Surface &sf = surfaces[surface];
+      return sf.eyeCount ? sf.height - eye.heightDefault[sf.eyes[0]] : sf.height;
+    }
+
+    // ---------------------------
+    // Basic animation methods with modified close/open behavior
+    void close() {
+      if (deferred(CMD_CLOSE, true, true)) return;
+      for (uint8_t i = 0; i < eye.count; i++) {
+        eye.heightNext[i] = 1;
+        eye.open[i] = false;
+        eye.radiusNext[i] = 0;
+      }
+      wake();
+    }
+    void open() {
+      if (deferred(CMD_OPEN, true, true)) return;
+      for (uint8_t i = 0; i < eye.count; i++) {
+        eye.open[i] = true;
+        eye.heightNext[i] = eye.heightDefault[i];
+        eye.radiusNext[i] = eye.radiusDefault[i];
+      }
+      wake();
+    }
+    void blink(bool left = true, bool right = true) {
+      if (deferred(CMD_BLINK, left, right)) return;
+      uint8_t mask = 0;
+      for (uint8_t i = 0; i < eye.count; i++) {
+        if (eye.side[i] > 0 ? right : left) mask |= 1 << i;
+      }
+      playClip(ROBOEYES_CLIP_BLINK, 0, mask);
+    }
+    void close(bool left, bool right) {
+      if (deferred(CMD_CLOSE, left, right)) return;
+      for (uint8_t i = 0; i < eye.count; i++) {
+        if (eye.side[i] > 0 ? !right : !left) continue;
+        eye.heightNext[i] = 1;
+        eye.open[i] = false;
+        eye.radiusNext[i] = 0;
+      }
+      wake();
+    }
+    void open(bool left, bool right) {
+      if (deferred(CMD_OPEN, left, right)) return;
+      for (uint8_t i = 0; i < eye.count; i++) {
+        if (eye.side[i] > 0 ? !right : !left) continue;
+        eye.open[i] = true;
+        eye.heightNext[i] = eye.heightDefault[i];
+        eye.radiusNext[i] = eye.radiusDefault[i];
+      }
+      wake();
+    }
+
+    void anim_confused() {
+      if (deferred(CMD_CONFUSED)) return;
+      if (!isClipPlaying(ROBOEYES_CLIP_CONFUSED)) playClip(ROBOEYES_CLIP_CONFUSED);
+    }
+    void anim_laugh() {
+      if (deferred(CMD_LAUGH)) return;
+      if (!isClipPlaying(ROBOEYES_CLIP_LAUGH)) playClip(ROBOEYES_CLIP_LAUGH);
+    }
+
+    // ---------------------------
+    // Animation clips
+
+    // Play a clip (see ROBOEYES_CLIP_VERSION for the format) on top of
+    // whatever else is playing, fading it in over blendMs. eyeMask limits
+    // it to some eyes (bit i = eye i). The clip data is read in place and
+    // must stay valid while it plays. Returns false if it is not a clip or
+    // all ROBOEYES_CLIP_SLOTS are busy.
+    bool playClip(const uint8_t *clip, uint16_t blendMs = 0, uint8_t eyeMask = 0xFF) {
+      if (deferred(CMD_PLAY, eyeMask, false, blendMs, 0, clip)) return true;
+      if (!clip || pgm_read_byte(clip) != 'R' || pgm_read_byte(clip + 1) != 'E'
+          || pgm_read_byte(clip + 2) != ROBOEYES_CLIP_VERSION) return false;
+      for (uint8_t s = 0; s < ROBOEYES_CLIP_SLOTS; s++) {
+        ClipSlot &slot = clipSlots[s];
+        if (slot.clip) continue;
+        slot.clip = clip;
+        slot.start = ROBOEYES_MILLIS();
+        slot.blendIn = blendMs;
+        slot.eyeMask = eyeMask;
+        slot.stopping = false;
+        wake();
+        return true;
+      }
+      return false;
+    }
+
+    // Blend from everything playing now into a clip over blendMs
+    bool crossfadeClip(const uint8_t *clip, uint16_t blendMs, uint8_t eyeMask = 0xFF) {
+      if (deferred(CMD_PLAY, eyeMask, true, blendMs, 0, clip)) return true;
+      stopClip(nullptr, blendMs);
+      return playClip(clip, blendMs, eyeMask);
+    }
+
+    // Fade out every instance of a clip over blendMs (0 = cut);
+    // nullptr stops all clips
+    void stopClip(const uint8_t *clip, uint16_t blendMs = 0) {
+      if (deferred(CMD_STOP, 0, 0, blendMs, 0, clip)) return;
+      for (uint8_t s = 0; s < ROBOEYES_CLIP_SLOTS; s++) {
+        ClipSlot &slot = clipSlots[s];
+        if (!slot.clip || slot.stopping || (clip && slot.clip != clip)) continue;
+        slot.stopping = true;
+        slot.stopStart = ROBOEYES_MILLIS();
+        slot.blendOut = blendMs;
+      }
+      wake();
+    }
+
+    bool isClipPlaying(const uint8_t *clip) {
+      for (uint8_t s = 0; s < ROBOEYES_CLIP_SLOTS; s++) {
+        if (clipSlots[s].clip && clipSlots[s].clip == clip) return true;
+      }
+      return false;
+    }
+
+    // FNV-1a checksum of the RGB565 pixels of a surface's last frame, for
+    // comparing runs against known-good (golden) values. Computed from the
+    // eye shapes in mainColor and bgColor, so dirty-rect, band and DMA
+    // modes give the same value. It is what the panel shows at 16 bits and
+    // with 1/4-bit palettes. An 8-bit buffer reduces colors to RGB332, and
+    // the checksum only matches the panel then for colors that survive
+    // that (black, white, ...). Surfaces with layers or textures are read
+    // back from the frame buffer (not in band mode, where they are left out).
+    uint32_t getFrameChecksum(uint8_t surface = 0) {
+      uint32_t h = 2166136261UL;
+      frameRows(surfaces[surface], [&](int, int, int w, uint16_t color) {
+        for (int i = 0; i < w; i++) {
+          h = (h ^ (color >> 8)) * 16777619UL;
+          h = (h ^ (color & 0xFF)) * 16777619UL;
+        }
+      });
+      return h;
+    }
+
+    // Write a surface's last frame as a binary PPM (P6) image, e.g. to a
+    // file on a host build or a serial link. Colors as for getFrameChecksum().
+    void writeFramePPM(Print &out, uint8_t surface = 0) {
+      Surface &sf = surfaces[surface];
+      out.print("P6\n");
+      out.print(sf.width);
+      out.print(' ');
+      out.print(sf.height);
+      out.print("\n255\n");
+      frameRows(sf, [&](int, int, int w, uint16_t color) {
+        uint8_t rgb[3] = {(uint8_t)((color >> 8) & 0xF8), (uint8_t)((color >> 3) & 0xFC), (uint8_t)(color << 3)};
+        for (int i = 0; i < w; i++) out.write(rgb, 3);
+      });
+    }
+
+    // Number of pixels sent to the display in the last frame
+    uint32_t getPixelsPushed() {
+      return pixelsPushed;
+    }
+
+    // True while the eyes are at rest: the last frame was identical to the
+    // one before, so nothing was rendered or pushed
+    bool isIdle() {
+      return frameSkipped;
+    }
+
+    // Number of frames skipped because nothing had changed
+    uint32_t framesSkipped() {
+      return skippedFrames;
+    }
+
+#if ROBOEYES_MIRROR
+    // ---------------------------
+    // Mirror stream
+    // Send what a surface shows to any Print (a UART, a socket, ...) for
+    // remote monitoring: each pushed frame as the rows that changed,
+    // run-length encoded, with a keyframe of the whole surface every
+    // keyframeInterval frames (0 = only the first, or when requested).
+    // Decode on a host with tools/roboeyes_mirror.py. Frames are encoded
+    // while they are written, through a ROBOEYES_MIRROR_BUFFER byte
+    // buffer; frames that did not change send nothing. The sink is
+    // written from update() (the render task, if it runs), so a record is
+    // only sent if availableForWrite() has room for all of it; otherwise
+    // the frame is dropped and the next one sent is a keyframe. Give the
+    // sink a buffer that holds a keyframe (e.g. Serial.setTxBufferSize()).
+    // A sink reporting 0 (Print's default, e.g. WiFiClient) is taken to
+    // not know its room and is written to directly. If the sink takes
+    // less than it is given (disconnected), or has room for less than the
+    // smallest record the frame can make, the next attempt is a keyframe,
+    // keyframeInterval frames later. nullptr stops mirroring.
+    //
+    // Record: 'R' 'M' version 'K'|'D' surface frame(u16) width(u16)
+    // height(u16) ranges(u8), then per range y(u16) rows(u16) and the runs
+    // of each row, then a Fletcher-16 (u16) of everything after 'R' 'M'.
+    // A run is one byte, length - 1 in the high nibble and a color index
+    // in the low one; length nibble 15 is followed by the length (u16),
+    // index 15 by an RGB565 color (u16) that takes the next free index
+    // (up to 15, reset by keyframes). Integers are little endian.
+    void setMirror(Print *out, uint8_t surface = 0, uint16_t keyframeInterval = 100) {
+      mirrorOut = out;
+      mirrorSurface = surface;
+      mirrorKeyInterval = keyframeInterval;
+      mirrorFailed = false;
+      requestMirrorKeyframe();
+    }
+
+    // Send the whole surface with the next frame, e.g. when a client connects
+    void requestMirrorKeyframe() {
+      mirrorNeedKey = true;
+    }
+
+    // Bytes written to the mirror sink so far
+    uint32_t getMirrorBytes() {
+      return mirrorBytes;
+    }
+
+    // Frames dropped because the sink had no room for them
+    uint32_t getMirrorDropped() {
+      return mirrorDropped;
+    }
+#endif
+
+    // Number of sprite pixels written while rendering the last frame
+    uint32_t getPixelsWritten() {
+      return pixelsWritten;
+    }
+
+    // Average number of times each pushed pixel was written in the last
+    // frame, in 1/100ths (100 = every pixel written exactly once).
+    uint32_t getOverdraw() {
+      return pixelsPushed ? (pixelsWritten * 100UL) / pixelsPushed : 0;
+    }
+
+  protected:
+    // Renderer entry points. TFT_RoboEyes uses the versions with every
+    // feature enabled; RoboEyes<> points them at a specialization.
+    DrawEyesFn drawEyesFn;
+    RasterRowFn rasterRowFn;
+    RowSpansFn rowSpansFn;
+
+    void drawEyes() {
+      (this->*drawEyesFn)();
+    }
+
+    void rasterRow(Surface &sf, int yy, int x0, int x1, uint8_t worker) {
+      (this->*rasterRowFn)(sf, yy, x0, x1, worker);
+    }
+
+    // Rasterize the rows of rects on a surface, every pixel written once.
+    // With render workers the rows the rects span are cut into one stripe
+    // per worker; the calling task renders the first stripe and waits for
+    // the helpers to finish theirs.
+    void rasterRects(Surface &sf, const Rect *rects, uint8_t count) {
+      for (uint8_t i = 0; i < count; i++) {
+        pixelsWritten += (uint32_t)rects[i].w * rects[i].h;
+      }
+#if ROBOEYES_TASK
+      if (workerCount > 1) {
+        jobSurface = &sf;
+        jobRects = rects;
+        jobCount = count;
+        for (uint8_t k = 1; k < workerCount; k++) xTaskNotifyGive(workers[k].task);
+        rasterStripe(sf, rects, count, 0);
+        for (uint8_t k = 1; k < workerCount; k++) xSemaphoreTake(workers[k].done, portMAX_DELAY);
+        return;
+      }
+#endif
+      rasterStripe(sf, rects, count, 0);
+    }
+
+    // Rasterize one worker's stripe: of n workers, worker k takes rows
+    // [top + h * k / n, top + h * (k + 1) / n) of the h rows the rects span,
+    // in every rect. Side by side rects can share a byte at 1/4 bits, so
+    // each row is left to a single worker.
+    void rasterStripe(Surface &sf, const Rect *rects, uint8_t count, uint8_t worker) {
+      int top = 0, bottom = 0;
+      for (uint8_t i = 0; i < count; i++) {
+        if (i == 0 || rects[i].y < top) top = rects[i].y;
+        bottom = max(bottom, rects[i].y + rects[i].h);
+      }
+      int y0 = top + (bottom - top) * worker / workerCount;
+      int y1 = top + (bottom - top) * (worker + 1) / workerCount;
+      for (uint8_t i = 0; i < count; i++) {
+        const Rect &r = rects[i];
+        int end = min(y1, r.y + r.h);
+        for (int yy = max(y0, r.y); yy < end; yy++) rasterRow(sf, yy, r.x, r.x + r.w, worker);
+      }
+    }
+
+    static void restartReplay(Surface &sf) {
+      for (uint8_t w = 0; w < ROBOEYES_WORKERS; w++) sf.replayAt[w].row = -1;
+    }
+
+    // ---------------------------
+    // Core drawing logic – adapts animations and draws the eyes on the sprite.
+    // Features left out of Spec are compiled out of the frame.
+    template <class Spec>
+    void drawEyesT() {
+      const bool useCyclops = (Spec::features & ROBOEYES_FEATURE_CYCLOPS) && cyclops;
+      const bool useFlicker = (Spec::features & ROBOEYES_FEATURE_FLICKER) != 0;
+      const uint8_t n = eye.count;
+
+      // --- PRE-CALCULATIONS ---
+      // Curious: eyes grow when looking towards their outer edge (a lone
+      // cyclops eye towards either edge)
+      for (uint8_t i = 0; i < n; i++) {
+        int8_t side = useCyclops ? 0 : eye.side[i];
+        int edge = specWidth<Spec>(surfaces[eye.surface[i]]) - eye.widthCurrent[i] - 10;
+        eye.heightOffset[i] = 0;
+        if (curious && ((side <= 0 && eye.xNext[i] <= 10) || (side >= 0 && eye.xNext[i] >= edge))) {
+          eye.heightOffset[i] = 8;
+        }
+      }
+
+      // Advance every eased value by the time since the last frame, sum up
+      // the offsets of the clips playing and step a color fade
+      easeStep(ROBOEYES_MILLIS());
+      evalClips(ROBOEYES_MILLIS());
+      stepFade(ROBOEYES_MILLIS());
+      pollGaze(ROBOEYES_MILLIS());
+
+      // Smooth eye height and width transitions; clips close the eyes
+      // towards a 1 px slit with square corners
+      for (uint8_t i = 0; i < n; i++) {
+        int shut = max(0, min(100, (int)clipValue[ROBOEYES_CLIP_CLOSE][i]));
+        int height = eye.heightNext[i] + eye.heightOffset[i] + clipValue[ROBOEYES_CLIP_HEIGHT][i];
+        height -= (height - 1) * shut / 100;
+        eye.heightCurrent[i] = ease(easeAcc[EASE_HEIGHT][i], height);
+        if (eye.open[i] && eye.heightCurrent[i] <= 1 + eye.heightOffset[i]) {
+          eye.heightNext[i] = eye.heightDefault[i];
+        }
+        eye.widthCurrent[i] = ease(easeAcc[EASE_WIDTH][i], eye.widthNext[i] + clipValue[ROBOEYES_CLIP_WIDTH][i]);
+      }
+      spaceBetweenCurrent = ease(easeSpace, spaceBetweenNext);
+
+      // Following eyes sit right of their neighbour: pos + width + space
+      for (uint8_t s = 0; s < surfaceCount; s++) {
+        const Surface &sf = surfaces[s];
+        for (uint8_t k = 1; k < sf.eyeCount; k++) {
+          uint8_t i = sf.eyes[k], prev = sf.eyes[k - 1];
+          eye.xNext[i] = eye.xNext[prev] + eye.widthCurrent[prev] + spaceBetweenCurrent;
+          eye.yNext[i] = eye.yNext[prev];
+        }
+      }
+
+      // Smooth coordinate and border radius transitions; a gaze saccade
+      // lands at once
+      for (uint8_t i = 0; i < n; i++) {
+        if (gazeSaccade) {
+          easeSnap(easeAcc[EASE_X][i], eye.xNext[i]);
+          easeSnap(easeAcc[EASE_Y][i], eye.yNext[i]);
+        }
+        eye.x[i] = ease(easeAcc[EASE_X][i], eye.xNext[i]);
+        eye.y[i] = ease(easeAcc[EASE_Y][i], eye.yNext[i]);
+        // Keep eyes vertically centered while they blink or grow (curious)
+        eye.y[i] += ((eye.heightDefault[i] - eye.heightCurrent[i]) / 2) - eye.heightOffset[i] / 2;
+        int shut = max(0, min(100, (int)clipValue[ROBOEYES_CLIP_CLOSE][i]));
+        eye.radiusCurrent[i] = ease(easeAcc[EASE_RADIUS][i], eye.radiusNext[i] * (100 - shut) / 100);
+      }
+      gazeSaccade = false;
+
+      // --- MACRO ANIMATIONS ---
+      if (autoblinker && ROBOEYES_MILLIS() >= blinktimer) {
+        playClip(ROBOEYES_CLIP_BLINK);
+        blinktimer = ROBOEYES_MILLIS() + (blinkInterval * 1000UL) + (ROBOEYES_RANDOM(blinkIntervalVariation) * 1000UL);
+      }
+
+      if (idle && !gazeActive) {
+        if (ROBOEYES_MILLIS() >= idleAnimationTimer) {
+          int rangeX = getScreenConstraint_X(), rangeY = getScreenConstraint_Y();
+          long x = ROBOEYES_RANDOM(rangeX);
+          long y = ROBOEYES_RANDOM(rangeY);
+          aimLeads(x, rangeX, y, rangeY);
+          idleAnimationTimer = ROBOEYES_MILLIS() + (idleInterval * 1000UL) + (ROBOEYES_RANDOM(idleIntervalVariation) * 1000UL);
+        }
+      }
+
+      if (useFlicker && hFlicker) {
+        int dx = hFlickerAlternate ? hFlickerAmplitude : -hFlickerAmplitude;
+        for (uint8_t i = 0; i < n; i++) eye.x[i] += dx;
+        hFlickerAlternate = !hFlickerAlternate;
+      }
+
+      if (useFlicker && vFlicker) {
+        int dy = vFlickerAlternate ? vFlickerAmplitude : -vFlickerAmplitude;
+        for (uint8_t i = 0; i < n; i++) eye.y[i] += dy;
+        vFlickerAlternate = !vFlickerAlternate;
+      }
+
+      for (uint8_t i = 0; i < n; i++) {
+        eye.x[i] += clipValue[ROBOEYES_CLIP_X][i];
+        eye.y[i] += clipValue[ROBOEYES_CLIP_Y][i];
+      }
+
+      // Cyclops: only the first eye stays, the others fold away
+      if (useCyclops) {
+        for (uint8_t i = 1; i < n; i++) {
+          eye.widthCurrent[i] = 0;
+          eye.heightCurrent[i] = 0;
+          easeSnap(easeAcc[EASE_WIDTH][i], 0);
+          easeSnap(easeAcc[EASE_HEIGHT][i], 0);
+        }
+        spaceBetweenCurrent = 0;
+        easeSnap(easeSpace, 0);
+      }
+
+      // Prepare mood transitions: tired, angry, happy (angry wins over tired)
+      const bool isAngry = (Spec::features & ROBOEYES_FEATURE_ANGRY) && angry;
+      const bool isTired = (Spec::features & ROBOEYES_FEATURE_TIRED) && tired && !isAngry;
+      const bool isHappy = (Spec::features & ROBOEYES_FEATURE_HAPPY) && happy;
+      for (uint8_t i = 0; i < n; i++) {
+        int half = eye.heightCurrent[i] / 2;
+        eye.tiredHeight[i] = ease(easeAcc[EASE_TIRED][i], lidTarget(i, isTired, half, ROBOEYES_CLIP_TIRED));
+        eye.angryHeight[i] = ease(easeAcc[EASE_ANGRY][i], lidTarget(i, isAngry, half, ROBOEYES_CLIP_ANGRY));
+        eye.happyOffset[i] = ease(easeAcc[EASE_HAPPY][i], lidTarget(i, isHappy, half, ROBOEYES_CLIP_HAPPY));
+      }
+
+      // --- EYE SHAPES ---
+      buildEyeShapes<Spec>(useCyclops);
+#if ROBOEYES_TEXTURE
+      placeTextures();
+#endif
+
+      // --- STATIC FRAME CHECK ---
+      // Nothing to render or push on a surface if its frame matches the
+      // last one drawn there
+      frameSkipped = true;
+      pixelsWritten = 0;
+      pixelsPushed = 0;
+      for (uint8_t s = 0; s < surfaceCount; s++) {
+        Surface &sf = surfaces[s];
+        packFrame(sf, frameState);
+        sf.skipped = sameFrame(frameState, sf.last) && !fullRedraw && sf.overlayDirty[sf.drawBuffer].empty();
+        if (!sf.skipped) memcpy(&sf.last, &frameState, sizeof(frameState));
+        if (sf.skipped) {
+          sf.dirtyCount = 0;
+          continue;
+        }
+        frameSkipped = false;
+
+        // --- DIRTY REGIONS ---
+        // Every mainColor pixel lies inside the eye rectangles (the lids only
+        // ever cut into them), so the union of last and current eye boxes
+        // covers every pixel that can change this frame.
+        if (fullRedraw) sf.bufferStale[0] = sf.bufferStale[1] = true;
+        markDirty<Spec>(sf);
+#if ROBOEYES_CACHE
+        sf.replay = nullptr;
+        if (cacheArena || cacheImage) sf.replay = cachedFrame<Spec>(sf);
+#endif
+
+        // --- ACTUAL DRAWINGS ---
+        // Rasterize the dirty regions scanline by scanline: background and eye
+        // spans are emitted side by side, so every pixel is written once.
+        // A frame found in the expression cache is decoded instead.
+        // In band mode this happens band by band in pushBands() instead.
+        if (bandCount == 0) {
+          rasterRects(sf, sf.dirtyRects, sf.dirtyCount);
+          drawOverlays(sf);
+        }
+
+        // New palette: the frame buffer still holds the frame, but every
+        // pixel on the panel changes color
+        if (repaintAll) {
+          sf.dirtyRects[0] = fullRect<Spec>(sf);
+          sf.dirtyCount = 1;
+        }
+      }
+      fullRedraw = false;
+      repaintAll = false;
+      if (frameSkipped) skippedFrames++;
+    } // end drawEyes
+
+    // ---------------------------
+    // Scanline eye rasterizer
+    //
+    // Each eye is a rounded rectangle with the eyelids cut out of it. Tired
+    // and angry lids are triangles hanging from the row above the eye
+    // ("wedges"), the happy lid is a rounded rect pushed up from below.
+    // Instead of painting those shapes over each other, rasterRow() works
+    // out the visible spans of every row and fills each of them once.
+
+    static void addWedge(EyeShape &e, int x0, int x1, int h, bool anchorLeft) {
+      if (h <= 1 || x1 <= x0) return;  // lid does not reach into the eye
+      e.wedges[e.wedgeCount++] = LidWedge{x0, x1, h, anchorLeft};
+    }
+
+    // Turn the current geometry and lid heights into per-eye shapes
+    template <class Spec>
+    void buildEyeShapes(bool useCyclops) {
+      const bool useHappy = (Spec::features & ROBOEYES_FEATURE_HAPPY) != 0;
+      const bool useTired = (Spec::features & ROBOEYES_FEATURE_TIRED) != 0;
+      const bool useAngry = (Spec::features & ROBOEYES_FEATURE_ANGRY) != 0;
+      for (uint8_t i = 0; i < eye.count; i++) {
+        EyeShape &e = eye.shape[i];
+        if (useCyclops && i > 0) {
+          e = EyeShape();
+          e.w = e.h = 0;
+          continue;
+        }
+        int x = eye.x[i], y = eye.y[i], w = eye.widthCurrent[i], h = eye.heightCurrent[i];
+        e.x = x; e.y = y; e.w = w; e.h = h;
+        e.r = clampRadius(eye.radiusCurrent[i], w, h);
+        e.wedgeCount = 0;
+        e.happyX = x - 1;
+        e.happyY = y + h - eye.happyOffset[i] + 1;
+        e.happyW = w + 2;
+        e.happyH = (useHappy && eye.happyOffset[i] > 0) ? eye.heightDefault[i] : 0;
+        e.happyR = clampRadius(eye.radiusCurrent[i], e.happyW, e.happyH);
+
+        // Tired lids droop towards the outer corners, angry towards the
+        // inner ones; a lone (middle) eye gets a lid on each half
+        int8_t side = useCyclops ? 0 : eye.side[i];
+        if (side != 0) {
+          if (useTired) addWedge(e, x, x + w, eye.tiredHeight[i], side < 0);
+          if (useAngry) addWedge(e, x, x + w, eye.angryHeight[i], side > 0);
+        } else {
+          int mid = x + (w / 2);
+          if (useTired) {
+            addWedge(e, x, mid, eye.tiredHeight[i], true);
+            addWedge(e, mid, x + w, eye.tiredHeight[i], false);
+          }
+          if (useAngry) {
+            addWedge(e, x, mid, eye.angryHeight[i], false);
+            addWedge(e, mid, x + w, eye.angryHeight[i], false);
+          }
+        }
+        if (renderScale > 1) scaleShape(e, renderScale);
+      }
+    }
+
+    // Panel to frame buffer coordinates at render scale s (rounding down)
+    static int scaleDown(int v, int s) {
+      return v >= 0 ? v / s : -((s - 1 - v) / s);
+    }
+
+    static void scaleShape(EyeShape &e, int s) {
+      if (e.w <= 0 || e.h <= 0) return;
+      int x1 = scaleDown(e.x + e.w, s), y1 = scaleDown(e.y + e.h, s);
+      e.x = scaleDown(e.x, s);
+      e.y = scaleDown(e.y, s);
+      e.w = x1 - e.x;
+      e.h = y1 - e.y;
+      e.r = clampRadius(e.r / s, e.w, e.h);
+      for (uint8_t k = 0; k < e.wedgeCount; k++) {
+        LidWedge &lw = e.wedges[k];
+        lw.x0 = scaleDown(lw.x0, s);
+        lw.x1 = scaleDown(lw.x1, s);
+        lw.h /= s;
+      }
+      x1 = scaleDown(e.happyX + e.happyW, s);
+      y1 = scaleDown(e.happyY + e.happyH, s);
+      e.happyX = scaleDown(e.happyX, s);
+      e.happyY = scaleDown(e.happyY, s);
+      e.happyW = x1 - e.happyX;
+      e.happyH = y1 - e.happyY;
+      e.happyR = clampRadius(e.happyR / s, e.happyW, e.happyH);
+    }
+
+    // Integer square root (floor)
+    static int isqrt(int n) {
+      if (n <= 0) return 0;
+      int res = 0;
+      int bit = 1 << 14;
+      while (bit > n) bit >>= 2;
+      while (bit) {
+        if (n >= res + bit) { n -= res + bit; res = (res >> 1) + bit; }
+        else { res >>= 1; }
+        bit >>= 2;
+      }
+      return res;
+    }
+
+    // Horizontal inset of a rounded rect (height h, radius r) on row j
+    static int cornerInset(int j, int h, int r) {
+      int dy;
+      if (j < r) dy = r - j;
+      else if (j >= h - r) dy = j - (h - r - 1);
+      else return 0;
+      return r - isqrt(r * r - dy * dy + dy);
+    }
+
+    // Remove [a, b) from a list of half-open spans
+    static uint8_t cutSpan(int16_t (*spans)[2], uint8_t count, int a, int b) {
+      if (b <= a) return count;
+      uint8_t out = count;
+      for (uint8_t i = 0; i < count; i++) {
+        int s0 = spans[i][0], s1 = spans[i][1];
+        if (b <= s0 || a >= s1) continue;
+        if (a > s0 && b < s1) {          // split in two
+          spans[i][1] = a;
+          spans[out][0] = b; spans[out][1] = s1; out++;
+        } else if (a <= s0 && b >= s1) { // fully covered
+          spans[i][0] = spans[i][1] = 0;
+        } else if (a <= s0) {
+          spans[i][0] = b;
+        } else {
+          spans[i][1] = a;
+        }
+      }
+      return out;
+    }
+
+    // Visible spans of an eye on screen row yy; returns the span count
+    // (at most 6: the eye, one split per wedge and one for the happy lid)
+    template <class Spec>
+    static uint8_t eyeSpans(const EyeShape &e, int yy, int16_t (*spans)[2]) {
+      int j = yy - e.y;
+      if (e.w <= 0 || j < 0 || j >= e.h) return 0;
+      int inset = cornerInset(j, e.h, e.r);
+      spans[0][0] = e.x + inset;
+      spans[0][1] = e.x + e.w - inset;
+      uint8_t count = 1;
+      // Lid wedges: row j of the eye is row j + 1 of the triangle
+      const uint8_t wedgeCount = (Spec::features & (ROBOEYES_FEATURE_TIRED | ROBOEYES_FEATURE_ANGRY)) ? e.wedgeCount : 0;
+      for (uint8_t k = 0; k < wedgeCount; k++) {
+        const LidWedge &lw = e.wedges[k];
+        if (j >= lw.h - 1) continue;
+        int reach = ((lw.x1 - lw.x0) * (lw.h - 1 - j) + lw.h - 1) / lw.h;
+        if (lw.anchorLeft) count = cutSpan(spans, count, lw.x0, lw.x0 + reach + 1);
+        else count = cutSpan(spans, count, lw.x1 - reach, lw.x1 + 1);
+      }
+      // Happy lid: rounded rect covering the bottom of the eye
+      if (!(Spec::features & ROBOEYES_FEATURE_HAPPY)) return count;
+      int hj = yy - e.happyY;
+      if (hj >= 0 && hj < e.happyH) {
+        int hInset = cornerInset(hj, e.happyH, e.happyR);
+        count = cutSpan(spans, count, e.happyX + hInset, e.happyX + e.happyW - hInset);
+      }
+      return count;
+    }
+
+    // Panel size and frame buffer depth as the renderer for Spec sees them:
+    // constants in a RoboEyes<>, else the run-time values
+    template <class Spec>
+    static int specWidth(const Surface &sf) {
+      return Spec::width ? Spec::width : sf.width;
+    }
+    template <class Spec>
+    static int specHeight(const Surface &sf) {
+      return Spec::height ? Spec::height : sf.height;
+    }
+    template <class Spec>
+    uint8_t specDepth() {
+      return Spec::depth ? Spec::depth : colorDepth;
+    }
+
+    // Fill a horizontal run of pixels in a surface's frame buffer
+    template <class Spec>
+    void fillSpan(Surface &sf, int x, int y, int w, uint16_t color) {
+      uint8_t *row = sf.pixels + (uint32_t)(y - rasterOriginY) * sf.stride;
+      switch (specDepth<Spec>()) {
+        case 16: fill16((uint16_t *)row + x, w, swap16(color)); break;
+        case 8:  memset(row + x, color8(color), w); break;
+        case 4:  fill4(row, x, w, (color & 0x0F) * 0x11); break;
+        default: fill1(row, x, w, color ? 0xFF : 0x00); break;
+      }
+    }
+
+    // Eye pixels [x, x + w) of row y: mainColor, then the textures over it
+    template <class Spec>
+    void fillEye(Surface &sf, int x, int y, int w) {
+      fillSpan<Spec>(sf, x, y, w, inkMain);
+#if ROBOEYES_TEXTURE
+      if (!textured) return;
+      const TexturePlacement *placed = nullptr;
+      for (uint8_t k = 0; k < sf.eyeCount && !placed; k++) {
+        const EyeShape &e = eye.shape[sf.eyes[k]];
+        if (x >= e.x && x < e.x + e.w && y >= e.y && y < e.y + e.h) placed = texturePlaced[sf.eyes[k]];
+      }
+      if (!placed) return;
+      uint8_t *row = sf.pixels + (uint32_t)(y - rasterOriginY) * sf.stride;
+      for (uint8_t l = 0; l < ROBOEYES_TEXTURE_LAYERS; l++) {
+        const TexturePlacement &p = placed[l];
+        int ty = y - p.y;
+        int x0 = max(x, (int)p.x), x1 = min(x + w, p.x + p.w);
+        if (!p.w || ty < 0 || ty >= p.h || x1 <= x0) continue;
+        const uint16_t *src = p.pixels + ty * p.w - p.x;
+        const uint16_t clear = textures[l].transparent;
+        if (specDepth<Spec>() == 16) {
+          for (int i = x0; i < x1; i++) {
+            if (src[i] != clear) ((uint16_t *)row)[i] = swap16(src[i]);
+          }
+        } else {
+          for (int i = x0; i < x1; i++) {
+            if (src[i] != clear) row[i] = color8(src[i]);
+          }
+        }
+      }
+#endif
+    }
+
+    // Background under [x, x + w) of row y: copied from the background
+    // layer, else bgColor
+    template <class Spec>
+    void fillBackground(Surface &sf, int x, int y, int w) {
+      if (!sf.layer) {
+        fillSpan<Spec>(sf, x, y, w, inkBg);
+        return;
+      }
+      uint32_t offset = (uint32_t)(y - rasterOriginY) * sf.stride;
+      copySpan<Spec>(sf.pixels + offset, sf.layer + offset, x, w);
+    }
+
+    // ---------------------------
+    // Span fill kernels
+    //
+    // Sprite rows are written directly instead of through
+    // TFT_eSprite::drawFastHLine() and its per-pixel loop: whole bytes with
+    // memset(), 16-bit pixels two per 32-bit store after an aligning head,
+    // 1/4-bit pixels as masked edge bytes around a memset().
+
+    // Sprite storage formats: RGB565 byte swapped, RGB332
+    static uint16_t swap16(uint16_t c) {
+      return (c >> 8) | (c << 8);
+    }
+    static uint8_t color8(uint16_t c) {
+      return ((c & 0xE000) >> 8) | ((c & 0x0700) >> 6) | ((c & 0x0018) >> 3);
+    }
+
+    // w 16-bit pixels of v from p
+    static void fill16(uint16_t *p, int w, uint16_t v) {
+      if ((v >> 8) == (v & 0xFF)) {  // black, white, ...
+        memset(p, v & 0xFF, (size_t)w * 2);
+        return;
+      }
+      if (((uintptr_t)p & 2) && w > 0) {
+        *p++ = v;
+        w--;
+      }
+      uint32_t pair = ((uint32_t)v << 16) | v;
+      uint32_t *q = (uint32_t *)p;
+      for (int n = w >> 1; n > 0; n--) *q++ = pair;
+      if (w & 1) *(uint16_t *)q = v;
+    }
+
+    // Pixels [x, x + w) of a 4-bit row, v = the index in both nibbles
+    // (even pixels in the high nibble)
+    static void fill4(uint8_t *row, int x, int w, uint8_t v) {
+      uint8_t *p = row + (x >> 1);
+      if ((x & 1) && w > 0) {
+        *p = (*p & 0xF0) | (v & 0x0F);
+        p++;
+        w--;
+      }
+      memset(p, v, w >> 1);
+      if (w & 1) p[w >> 1] = (p[w >> 1] & 0x0F) | (v & 0xF0);
+    }
+
+    // Pixels [x, x + w) of a 1-bit row set (v = 0xFF) or cleared (v = 0),
+    // the first pixel of each byte in its top bit
+    static void fill1(uint8_t *row, int x, int w, uint8_t v) {
+      uint8_t *p = row + (x >> 3);
+      int head = x & 7;
+      if (head && w > 0) {
+        int n = min(w, 8 - head);
+        uint8_t mask = (uint8_t)(0xFF >> head) & (uint8_t)(0xFF << (8 - head - n));
+        *p = (*p & ~mask) | (v & mask);
+        p++;
+        w -= n;
+      }
+      memset(p, v, w >> 3);
+      if (w & 7) {
+        uint8_t mask = (uint8_t)(0xFF << (8 - (w & 7)));
+        p[w >> 3] = (p[w >> 3] & ~mask) | (v & mask);
+      }
+    }
+
+    // Copy pixels [x, x + w) of a row to another row of the same format
+    template <class Spec>
+    void copySpan(uint8_t *dst, const uint8_t *src, int x, int w) {
+      switch (specDepth<Spec>()) {
+        case 16: memcpy(dst + x * 2, src + x * 2, (size_t)w * 2); break;
+        case 8:  memcpy(dst + x, src + x, w); break;
+        case 4:  copyBits(dst, src, x * 4, w * 4); break;
+        default: copyBits(dst, src, x, w); break;
+      }
+    }
+
+    // Copy bits [b, b + n) of a row, the first in the top bit of a byte
+    static void copyBits(uint8_t *dst, const uint8_t *src, int b, int n) {
+      dst += b >> 3;
+      src += b >> 3;
+      b &= 7;
+      if (b && n > 0) {
+        int k = min(n, 8 - b);
+        uint8_t mask = (uint8_t)(0xFF >> b) & (uint8_t)(0xFF << (8 - b - k));
+        *dst = (*dst & ~mask) | (*src & mask);
+        dst++;
+        src++;
+        n -= k;
+      }
+      memcpy(dst, src, n >> 3);
+      if (n & 7) {
+        uint8_t mask = (uint8_t)(0xFF << (8 - (n & 7)));
+        dst[n >> 3] = (dst[n >> 3] & ~mask) | (src[n >> 3] & mask);
+      }
+    }
+
+    // Clear a whole sprite to the background with one kernel call: rows
+    // are contiguous, and for 1/4 bits background is index 0
+    void clearBuffer(uint8_t *p, uint32_t bytes) {
+      if (colorDepth == 16) fill16((uint16_t *)p, bytes / 2, swap16(inkBg));
+      else if (colorDepth == 8) memset(p, color8(inkBg), bytes);
+      else memset(p, 0, bytes);
+    }
+
+    // Spans of every eye bound to a surface on row yy, sorted by start
+    template <class Spec>
+    uint8_t rowSpans(const Surface &sf, int yy, int16_t (*spans)[2]) {
+      uint8_t count = 0;
+      for (uint8_t k = 0; k < sf.eyeCount; k++) {
+        count += eyeSpans<Spec>(eye.shape[sf.eyes[k]], yy, spans + count);
+      }
+
+      // Sort by start (tiny list, insertion sort)
+      for (uint8_t i = 1; i < count; i++) {
+        int16_t s0 = spans[i][0], s1 = spans[i][1];
+        int8_t k = i - 1;
+        while (k >= 0 && spans[k][0] > s0) {
+          spans[k + 1][0] = spans[k][0]; spans[k + 1][1] = spans[k][1];
+          k--;
+        }
+        spans[k + 1][0] = s0; spans[k + 1][1] = s1;
+      }
+      return count;
+    }
+
+    // Rasterize row yy of a surface between x0 and x1: spans of the eyes
+    // bound to it in mainColor (and textures), the gaps between them in
+    // bgColor.
+    template <class Spec>
+    void rasterRowT(Surface &sf, int yy, int x0, int x1, uint8_t worker) {
+      int16_t spans[6 * ROBOEYES_MAX_EYES][2];
+      uint8_t count = sf.replay ? replaySpans(sf, sf.replayAt[worker], yy, spans)
+                                : rowSpans<Spec>(sf, yy, spans);
+
+      int cursor = x0;
+      for (uint8_t i = 0; i < count; i++) {
+        int s0 = max((int)spans[i][0], cursor);
+        int s1 = min((int)spans[i][1], x1);
+        if (s1 <= s0) continue;
+        if (s0 > cursor) fillBackground<Spec>(sf, cursor, yy, s0 - cursor);
+        fillEye<Spec>(sf, s0, yy, s1 - s0);
+        cursor = s1;
+      }
+      if (cursor < x1) fillBackground<Spec>(sf, cursor, yy, x1 - cursor);
+    }
+
+    // ---------------------------
+    // Expression cache
+    //
+    // A recorded frame covers the box around a surface's eyes: width and
+    // height (u16 each), then per row the count of runs and the runs (u8),
+    // alternately background and eye from the left edge of the box, or
+    // 0xFF for a row equal to the one above. Runs over 255 pixels are split
+    // by a zero-length run of the other color. In the arena and the flash
+    // image each frame follows the key it was recorded under.
+
+    // Eye spans on row yy of the frame a surface replays, decoded with cursor rc
+    static uint8_t replaySpans(const Surface &sf, ReplayCursor &rc, int yy, int16_t (*spans)[2]) {
+      int j = yy - sf.replayY;
+      if (j < 0 || j >= readWord(sf.replay + 2)) return 0;
+      if (rc.row < 0 || j < rc.row) {
+        rc.row = 0;
+        rc.at = sf.replay + 4;
+      }
+      for (; rc.row < j; rc.row++) {
+        uint8_t n = pgm_read_byte(rc.at);
+        if (n != 0xFF) rc.last = rc.at;
+        rc.at += n == 0xFF ? 1 : 1 + n;
+      }
+      const uint8_t *row = pgm_read_byte(rc.at) == 0xFF ? rc.last : rc.at;
+      uint8_t n = pgm_read_byte(row++);
+      uint8_t count = 0;
+      int x = sf.replayX;
+      for (uint8_t r = 0; r < n; r++) {
+        int len = pgm_read_byte(row + r);
+        if ((r & 1) && len) {
+          if (count && spans[count - 1][1] == x) spans[count - 1][1] = x + len;  // split run
+          else { spans[count][0] = x; spans[count][1] = x + len; count++; }
+        }
+        x += len;
+      }
+      return count;
+    }
+
+#if ROBOEYES_CACHE
+    // The recorded frame for a surface's eyes as they are now: looked up
+    // in the arena and the flash image, recorded on a miss. nullptr if it
+    // could not be recorded (the frame is then rasterized).
+    template <class Spec>
+    const uint8_t *cachedFrame(Surface &sf) {
+      Rect box = {0, 0, 0, 0};
+      for (uint8_t k = 0; k < sf.eyeCount; k++) {
+        const EyeShape &e = eye.shape[sf.eyes[k]];
+        box = unionRect(box, Rect{e.x, e.y, e.w, e.h});
+      }
+      if (box.empty()) return nullptr;
+
+      // Entries are matched on the whole key; its digest only skips the
+      // ones that cannot match
+      int32_t key[CACHE_KEY_WORDS];
+      uint32_t digest;
+      const uint16_t keyWords = cacheKey(sf, box, key, digest);
+      sf.replayX = box.x;
+      sf.replayY = box.y;
+      restartReplay(sf);
+
+      for (uint8_t i = 0; i < cacheCount; i++) {
+        const uint8_t *p = cacheArena + cacheEntries[i].offset;
+        if (cacheEntries[i].key != digest || !sameKey(p, key, keyWords)) continue;
+        cacheEntries[i].lastUse = ++cacheClock;
+        cacheHits++;
+        return keyedFrame(p);
+      }
+      if (cacheImage) {
+        const uint8_t *p = cacheImage + 6;
+        for (uint16_t n = readWord(cacheImage + 4); n > 0; n--) {
+          uint32_t k = readWord(p) | ((uint32_t)readWord(p + 2) << 16);
+          if (k == digest && sameKey(p + 6, key, keyWords)) {
+            cacheHits++;
+            return keyedFrame(p + 6);
+          }
+          p += 6 + readWord(p + 4);
+        }
+      }
+      cacheMisses++;
+      if (!cacheArena) return nullptr;
+
+      // Record key and frame, evicting older frames until they fit
+      if (cacheCount == ROBOEYES_CACHE_ENTRIES && !evictFrame()) return nullptr;
+      const uint32_t keyBytes = 2 + 2 * keyWords;
+      for (;;) {
+        uint32_t room = min(cacheBudget - cacheUsed, (uint32_t)0xFFFF);
+        uint8_t *p = cacheArena + cacheUsed;
+        uint32_t size = room > keyBytes ? encodeFrame<Spec>(sf, box, p + keyBytes, room - keyBytes) : 0;
+        if (size) {
+          p[0] = keyWords;
+          p[1] = keyWords >> 8;
+          for (uint16_t i = 0; i < keyWords; i++) {
+            p[2 + 2 * i] = key[i];
+            p[3 + 2 * i] = key[i] >> 8;
+          }
+          CacheEntry &e = cacheEntries[cacheCount++];
+          e.key = digest;
+          e.offset = cacheUsed;
+          e.size = keyBytes + size;
+          e.lastUse = ++cacheClock;
+          cacheUsed += e.size;
+          return keyedFrame(p);
+        }
+        if (!evictFrame()) return nullptr;  // too big for the whole cache
+      }
+    }
+
+    // Cache key of a surface's frame: the size of box (the eyes' bounding
+    // box) and the eyes' shapes relative to its corner. Returns the word
+    // count and sets digest to the FNV-1a of the words.
+    uint16_t cacheKey(const Surface &sf, const Rect &box, int32_t *key, uint32_t &digest) {
+      int32_t *end = key;
+      *end++ = box.w;
+      *end++ = box.h;
+      for (uint8_t k = 0; k < sf.eyeCount; k++) {
+        const EyeShape &e = eye.shape[sf.eyes[k]];
+        if (e.w > 0 && e.h > 0) end = packShape(end, e, box.x, box.y);
+        else *end++ = -1;  // hidden (cyclops)
+      }
+      digest = 2166136261UL;
+      for (const int32_t *w = key; w < end; w++) hashInt(digest, *w);
+      return end - key;
+    }
+
+    // An entry's key (word count, then the words as u16) and the frame
+    // recorded after it
+    static bool sameKey(const uint8_t *p, const int32_t *key, uint16_t keyWords) {
+      if (readWord(p) != keyWords) return false;
+      for (uint16_t i = 0; i < keyWords; i++) {
+        if (readWord(p + 2 + 2 * i) != (uint16_t)key[i]) return false;
+      }
+      return true;
+    }
+    static const uint8_t *keyedFrame(const uint8_t *p) {
+      return p + 2 + 2 * readWord(p);
+    }
+
+    // Run-length encode the box around a surface's eyes into out; returns
+    // the bytes used, or 0 if it needs more than room
+    template <class Spec>
+    uint32_t encodeFrame(const Surface &sf, const Rect &box, uint8_t *out, uint32_t room) {
+      if (room < 4) return 0;
+      uint8_t *p = out, *end = out + room;
+      *p++ = box.w; *p++ = box.w >> 8;
+      *p++ = box.h; *p++ = box.h >> 8;
+      uint8_t *last = nullptr;
+      int16_t spans[6 * ROBOEYES_MAX_EYES][2];
+      for (int yy = box.y; yy < box.y + box.h; yy++) {
+        uint8_t count = rowSpans<Spec>(sf, yy, spans);
+        uint8_t *row = p;
+        if (p++ >= end) return 0;
+        int cursor = box.x, runs = 0;
+        for (uint8_t i = 0; i < count; i++) {
+          int s0 = max((int)spans[i][0], cursor);
+          int s1 = min((int)spans[i][1], box.x + box.w);
+          if (s1 <= s0) continue;
+          if (!putRun(p, end, s0 - cursor, runs) || !putRun(p, end, s1 - s0, runs)) return 0;
+          cursor = s1;
+        }
+        if (runs > 254) return 0;  // 0xFF marks a repeated row
+        *row = runs;
+        if (last && *last == runs && memcmp(last + 1, row + 1, runs) == 0) {
+          *row = 0xFF;
+          p = row + 1;
+        } else {
+          last = row;
+        }
+      }
+      return p - out;
+    }
+
+    static bool putRun(uint8_t *&p, uint8_t *end, int len, int &runs) {
+      for (; len > 255; len -= 255, runs += 2) {
+        if (end - p < 2) return false;
+        *p++ = 255;
+        *p++ = 0;
+      }
+      if (p >= end) return false;
+      *p++ = len;
+      runs++;
+      return true;
+    }
+
+    // Drop the least recently used frame that no surface is replaying and
+    // close the gap it leaves in the arena
+    bool evictFrame() {
+      int8_t victim = -1;
+      for (uint8_t i = 0; i < cacheCount; i++) {
+        bool inUse = false;
+        for (uint8_t s = 0; s < surfaceCount; s++) {
+          inUse |= surfaces[s].replay == keyedFrame(cacheArena + cacheEntries[i].offset);
+        }
+        if (inUse) continue;
+        if (victim < 0 || cacheEntries[i].lastUse < cacheEntries[victim].lastUse) victim = i;
+      }
+      if (victim < 0) return false;
+
+      CacheEntry gone = cacheEntries[victim];
+      uint8_t *hole = cacheArena + gone.offset;
+      memmove(hole, hole + gone.size, cacheUsed - gone.offset - gone.size);
+      cacheUsed -= gone.size;
+      cacheEntries[victim] = cacheEntries[--cacheCount];
+      for (uint8_t i = 0; i < cacheCount; i++) {
+        if (cacheEntries[i].offset > gone.offset) cacheEntries[i].offset -= gone.size;
+      }
+      for (uint8_t s = 0; s < surfaceCount; s++) {
+        Surface &sf = surfaces[s];
+        if (sf.replay > hole && sf.replay < cacheArena + cacheUsed + gone.size) {
+          sf.replay -= gone.size;
+          restartReplay(sf);
+        }
+      }
+      cacheEvictions++;
+      return true;
+    }
+#endif
+
+#if ROBOEYES_TEXTURE
+    // ---------------------------
+    // Eye textures
+    //
+    // Every frame, each layer gets a size from the eye it is drawn on,
+    // rounded to ROBOEYES_TEXTURE_STEP, and a position from the gaze. The
+    // variant of that size is looked up in the arena or scaled into it
+    // once; rasterizing then only copies its rows into the eye spans.
+
+    bool hasTextures() {
+      for (uint8_t l = 0; l < ROBOEYES_TEXTURE_LAYERS; l++) {
+        if (textures[l].image || textures[l].indexed) return true;
+      }
+      return false;
+    }
+
+    // Size, position and variant of every texture layer on every eye
+    void placeTextures() {
+      textured = false;
+      if (!textureArena || (colorDepth != 8 && colorDepth != 16)) return;
+      const uint32_t frameStart = textureClock;
+      const int scale = renderScale;
+      for (uint8_t i = 0; i < eye.count; i++) {
+        const EyeShape &e = eye.shape[i];
+        // The open eye, so blinks and lids cut into the texture instead of
+        // squashing it
+        int openH = eye.heightDefault[i] / scale;
+        int base = min(e.w, openH);
+        int rangeX = max(1, getScreenConstraint_X(eye.surface[i]) / 2);
+        int rangeY = max(1, getScreenConstraint_Y(eye.surface[i]) / 2);
+        // Where the eye looks, without the blink centering
+        int gazeY = eye.y[i] - (eye.heightDefault[i] - eye.heightCurrent[i]) / 2 + eye.heightOffset[i] / 2;
+        for (uint8_t l = 0; l < ROBOEYES_TEXTURE_LAYERS; l++) {
+          TexturePlacement &p = texturePlaced[i][l];
+          const Texture &t = textures[l];
+          p.w = 0;
+          if ((!t.image && !t.indexed) || e.w <= 0 || e.h <= 0) continue;
+          int side = (base * t.size / 100 + ROBOEYES_TEXTURE_STEP / 2) / ROBOEYES_TEXTURE_STEP * ROBOEYES_TEXTURE_STEP;
+          if (side <= 0) continue;
+          int w = t.w >= t.h ? side : max(1, side * t.w / t.h);
+          int h = t.w >= t.h ? max(1, side * t.h / t.w) : side;
+          int roomX = max(0, (e.w - w) / 2), roomY = max(0, (openH - h) / 2);
+          int dx = (eye.x[i] - eye.xDefault[i]) * roomX * t.follow / (100 * rangeX);
+          int dy = (gazeY - eye.yDefault[i]) * roomY * t.follow / (100 * rangeY);
+          dx = dx < -roomX ? -roomX : (dx > roomX ? roomX : dx);
+          dy = dy < -roomY ? -roomY : (dy > roomY ? roomY : dy);
+          if (findVariant(l, w, h, frameStart) < 0) continue;  // does not fit the cache
+          p.x = e.x + (e.w - w) / 2 + dx;
+          p.y = e.y + e.h / 2 - h / 2 + dy;
+          p.w = w;
+          p.h = h;
+        }
+      }
+      // Scaling may have moved variants in the arena: point at them last
+      for (uint8_t i = 0; i < eye.count; i++) {
+        for (uint8_t l = 0; l < ROBOEYES_TEXTURE_LAYERS; l++) {
+          TexturePlacement &p = texturePlaced[i][l];
+          if (!p.w) continue;
+          for (uint8_t v = 0; v < textureVariantCount; v++) {
+            const TextureVariant &tv = textureVariants[v];
+            if (tv.layer == l && tv.w == p.w && tv.h == p.h) {
+              p.pixels = (const uint16_t *)(textureArena + tv.offset);
+              break;
+            }
+          }
+          textured = true;
+        }
+      }
+    }
+
+    // Index of the variant of a layer at w x h, scaled into the arena on a
+    // miss; -1 if it does not fit without evicting one used this frame
+    int8_t findVariant(uint8_t layer, int w, int h, uint32_t frameStart) {
+      for (uint8_t v = 0; v < textureVariantCount; v++) {
+        TextureVariant &tv = textureVariants[v];
+        if (tv.layer != layer || tv.w != w || tv.h != h) continue;
+        tv.lastUse = ++textureClock;
+        textureHits++;
+        return v;
+      }
+      textureMisses++;
+      uint32_t bytes = ((uint32_t)w * h * 2 + 3) & ~3UL;  // keep variants 32-bit aligned
+      if (bytes > textureBudget) return -1;
+      while (textureVariantCount == ROBOEYES_TEXTURE_ENTRIES || textureBudget - textureUsed < bytes) {
+        if (!evictVariant(frameStart)) return -1;
+      }
+      TextureVariant &tv = textureVariants[textureVariantCount];
+      tv = TextureVariant{layer, (int16_t)w, (int16_t)h, textureUsed, ++textureClock};
+      scaleTexture(textures[layer], (uint16_t *)(textureArena + textureUsed), w, h);
+      textureUsed += bytes;
+      return textureVariantCount++;
+    }
+
+    // Nearest-neighbour scale of a texture to w x h RGB565 pixels
+    static void scaleTexture(const Texture &t, uint16_t *out, int w, int h) {
+      for (int y = 0; y < h; y++) {
+        uint32_t row = (uint32_t)((2 * y + 1) * t.h / (2 * h)) * t.w;
+        for (int x = 0; x < w; x++) {
+          int sx = (2 * x + 1) * t.w / (2 * w);
+          *out++ = t.image ? pgm_read_word(t.image + row + sx)
+                           : pgm_read_word(t.palette + pgm_read_byte(t.indexed + row + sx));
+        }
+      }
+    }
+
+    // Drop the least recently used variant not used this frame and close
+    // the gap it leaves in the arena
+    bool evictVariant(uint32_t frameStart) {
+      int8_t victim = -1;
+      for (uint8_t v = 0; v < textureVariantCount; v++) {
+        if (textureVariants[v].lastUse > frameStart) continue;
+        if (victim < 0 || textureVariants[v].lastUse < textureVariants[victim].lastUse) victim = v;
+      }
+      if (victim < 0) return false;
+      TextureVariant gone = textureVariants[victim];
+      uint32_t size = ((uint32_t)gone.w * gone.h * 2 + 3) & ~3UL;
+      uint8_t *hole = textureArena + gone.offset;
+      memmove(hole, hole + size, textureUsed - gone.offset - size);
+      textureUsed -= size;
+      textureVariants[victim] = textureVariants[--textureVariantCount];
+      for (uint8_t v = 0; v < textureVariantCount; v++) {
+        if (textureVariants[v].offset > gone.offset) textureVariants[v].offset -= size;
+      }
+      return true;
+    }
+#endif
+
+    // ---------------------------
+    // Eye table helpers
+
+    // Rebuild every surface's list of eyes, the side of each eye and the
+    // default (centered) positions
+    void relayout() {
+      for (uint8_t s = 0; s < surfaceCount; s++) surfaces[s].eyeCount = 0;
+      for (uint8_t i = 0; i < eye.count; i++) {
+        Surface &sf = surfaces[eye.surface[i]];
+        sf.eyes[sf.eyeCount++] = i;
+      }
+      // Sides follow the order of the eyes across surfaces: the first half
+      // is left, the second half right, an odd one out in the middle
+      uint8_t k = 0;
+      for (uint8_t s = 0; s < surfaceCount; s++) {
+        const Surface &sf = surfaces[s];
+        for (uint8_t j = 0; j < sf.eyeCount; j++, k++) {
+          eye.side[sf.eyes[j]] = k < eye.count / 2 ? -1 : (k >= (eye.count + 1) / 2 ? 1 : 0);
+        }
+        // Center the row of eyes on the surface
+        if (sf.eyeCount == 0) continue;
+        int rowWidth = 0;
+        for (uint8_t j = 0; j < sf.eyeCount; j++) {
+          rowWidth += eye.widthDefault[sf.eyes[j]] + (j ? spaceBetweenDefault : 0);
+        }
+        int x = (sf.width - rowWidth) / 2;
+        int y = (sf.height - eye.heightDefault[sf.eyes[0]]) / 2;
+        for (uint8_t j = 0; j < sf.eyeCount; j++) {
+          uint8_t i = sf.eyes[j];
+          eye.xDefault[i] = x;
+          eye.yDefault[i] = y;
+          x += eye.widthDefault[i] + spaceBetweenDefault;
+        }
+      }
+    }
+
+    // Send the first eye of every surface to the same relative spot,
+    // x / rangeX and y / rangeY of that surface's free area, so eyes on
+    // separate displays look the same way. Returns true if a target moved.
+    bool aimLeads(long x, long rangeX, long y, long rangeY) {
+      bool moved = false;
+      for (uint8_t s = 0; s < surfaceCount; s++) {
+        if (surfaces[s].eyeCount == 0) continue;
+        uint8_t i = surfaces[s].eyes[0];
+        int nx = rangeX ? x * getScreenConstraint_X(s) / rangeX : 0;
+        int ny = rangeY ? y * getScreenConstraint_Y(s) / rangeY : 0;
+        moved |= nx != eye.xNext[i] || ny != eye.yNext[i];
+        eye.xNext[i] = nx;
+        eye.yNext[i] = ny;
+      }
+      return moved;
+    }
+
+    // ---------------------------
+    // Command queue helpers
+
+    // Queue a setter call instead of running it when the render task owns
+    // the eye state and the caller is another task or an ISR. A state
+    // setter repeating the last values it posted is dropped right here.
+    bool deferred(uint8_t op, uint8_t a = 0, uint8_t b = 0, uint16_t c = 0, uint16_t d = 0,
+                  const uint8_t *clip = nullptr) {
+#if ROBOEYES_TASK
+      if (renderTask == nullptr) return false;
+      if (!xPortInIsrContext() && xTaskGetCurrentTaskHandle() == renderTask) return false;
+      Command cmd = {op, a, b, c, d, clip};
+      int8_t slot = stateSlot(op);
+      if (slot >= 0 && postedValid[slot] && sameCommand(postedState[slot], cmd)) return true;
+      if (postCommand(cmd) && slot >= 0) {
+        postedState[slot] = cmd;
+        postedValid[slot] = true;
+      }
+      return true;
+#else
+      (void)op; (void)a; (void)b; (void)c; (void)d; (void)clip;
+      return false;
+#endif
+    }
+
+#if ROBOEYES_TASK
+    // Slot of the state a setter sets, or -1 for events (blinks, clips,
+    // invalidations) and gaze targets, which always go through: the eyes
+    // may have moved or finished the animation since the last one.
+    // setColors() and fadeColors() share a slot, so going back to colors
+    // set before is not taken for a repeat.
+    static int8_t stateSlot(uint8_t op) {
+      switch (op) {
+        case CMD_WIDTH:       return 0;
+        case CMD_HEIGHT:      return 1;
+        case CMD_RADIUS:      return 2;
+        case CMD_SPACE:       return 3;
+        case CMD_MOOD:        return 4;
+        case CMD_AUTOBLINKER: return 5;
+        case CMD_IDLEMODE:    return 6;
+        case CMD_CURIOSITY:   return 7;
+        case CMD_CYCLOPS:     return 8;
+        case CMD_HFLICKER:    return 9;
+        case CMD_VFLICKER:    return 10;
+        case CMD_COLORS:
+        case CMD_FADE:        return 11;
+        default:              return -1;
+      }
+    }
+
+    static bool sameCommand(const Command &x, const Command &y) {
+      return x.op == y.op && x.a == y.a && x.b == y.b && x.c == y.c && x.d == y.d && x.clip == y.clip;
+    }
+
+    // Returns false if the command was dropped (ISR, queue full)
+    bool postCommand(const Command &cmd) {
+      bool isr = xPortInIsrContext();
+      uint16_t head = commandHead.load(std::memory_order_relaxed);
+      while ((uint16_t)(head - commandTail.load(std::memory_order_acquire)) >= ROBOEYES_QUEUE_SIZE) {
+        if (isr) { droppedCommands++; return false; }
+        xTaskNotifyGive(renderTask);  // full: have the render task drain it
+        vTaskDelay(1);
       }
+      commandQueue[head & (ROBOEYES_QUEUE_SIZE - 1)] = cmd;
+      commandHead.store(head + 1, std::memory_order_release);
 
-      // Smooth eye width transition
-      eyeLwidthCurrent = (eyeLwidthCurrent + eyeLwidthNext) / 2;
-      eyeRwidthCurrent = (eyeRwidthCurrent + eyeRwidthNext) / 2;
-      spaceBetweenCurrent = (spaceBetweenCurrent + spaceBetweenNext) / 2;
+      // Wake the render task early only if it is idling or the queue is
+      // filling up; otherwise commands wait for the next frame and coalesce
+      bool sleeping = renderSleeping.load(std::memory_order_relaxed);
+      if (sleeping || (uint16_t)(head + 1 - commandTail.load(std::memory_order_relaxed)) >= ROBOEYES_QUEUE_SIZE / 2) {
+        notifyRenderTask();
+      }
+      return true;
+    }
+
+    void notifyRenderTask() {
+      if (xPortInIsrContext()) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(renderTask, &woken);
+        if (woken) portYIELD_FROM_ISR();
+      } else {
+        xTaskNotifyGive(renderTask);
+      }
+    }
 
-      // Smooth coordinate transitions
-      eyeLx = (eyeLx + eyeLxNext) / 2;
-      eyeLy = (eyeLy + eyeLyNext) / 2;
-      // Right eye position depends on left eye pos + space + eye width
-      eyeRxNext = eyeLxNext + eyeLwidthCurrent + spaceBetweenCurrent;
-      eyeRyNext = eyeLyNext;
-      eyeRx = (eyeRx + eyeRxNext) / 2;
-      eyeRy = (eyeRy + eyeRyNext) / 2;
+    static void renderTaskLoop(void *arg) {
+      ((TFT_RoboEyes *)arg)->renderLoop();
+    }
 
-      // Smooth border radius transitions
-      eyeLborderRadiusCurrent = (eyeLborderRadiusCurrent + eyeLborderRadiusNext) / 2;
-      eyeRborderRadiusCurrent = (eyeRborderRadiusCurrent + eyeRborderRadiusNext) / 2;
+    // Helper render worker: rasterize its stripe of each job posted by
+    // rasterRects(), until an empty job
+    static void workerTaskLoop(void *arg) {
+      Worker &wk = *(Worker *)arg;
+      TFT_RoboEyes &owner = *wk.owner;
+      for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        Surface *sf = owner.jobSurface;
+        if (sf) owner.rasterStripe(*sf, owner.jobRects, owner.jobCount, wk.index);
+        xSemaphoreGive(wk.done);
+        if (!sf) break;
+      }
+      vTaskDelete(nullptr);
+    }
 
-      // --- MACRO ANIMATIONS ---
-      if (autoblinker && !blinkingActive) {
-        if (millis() >= blinktimer) {
-          close();
-          blinkingActive = true;
-          blinkCloseDurationTimer = millis() + blinkCloseDuration; 
-          blinktimer = millis() + (blinkInterval * 1000UL) + (random(blinkIntervalVariation) * 1000UL);
+    // Send the helper workers an empty job and wait for each to exit
+    void stopWorkers() {
+      jobSurface = nullptr;
+      for (uint8_t k = 1; k < workerCount; k++) {
+        xTaskNotifyGive(workers[k].task);
+        xSemaphoreTake(workers[k].done, portMAX_DELAY);
+        vSemaphoreDelete(workers[k].done);
+      }
+      workerCount = 1;
+    }
+
+    void renderLoop() {
+      while (!renderStop.load(std::memory_order_acquire)) {
+        // Sleep until the next deadline or until a command wakes us early.
+        // Producers only wake us while we sleep past the next interval.
+        long wait = (long)(nextFrameTime - ROBOEYES_MILLIS());
+        if (wait > 0) {
+          TickType_t ticks = pdMS_TO_TICKS(wait);
+          renderSleeping.store(wait > frameInterval, std::memory_order_relaxed);
+          uint32_t woken = ulTaskNotifyTake(pdTRUE, ticks ? ticks : 1);
+          renderSleeping.store(false, std::memory_order_relaxed);
+          if (woken) {
+            drainCommands();
+            if (gazeSeq != gazeSeen) wake();
+          }
         }
+        update();
+      }
+      // Stopping (see stopRenderTask()): nothing may touch this object
+      // once the stopper is notified
+      drainCommands();
+      xTaskNotifyGive(renderStopper);
+      vTaskDelete(nullptr);
+    }
+#endif
+
+    // Apply every queued command. Gaze targets are coalesced: only the last
+    // setPosition() since the previous drain is applied.
+    void drainCommands() {
+#if ROBOEYES_TASK
+      uint16_t tail = commandTail.load(std::memory_order_relaxed);
+      uint16_t head = commandHead.load(std::memory_order_acquire);
+      if (tail == head) return;
+      int16_t gaze = -1;
+      while (tail != head) {
+        const Command &cmd = commandQueue[tail & (ROBOEYES_QUEUE_SIZE - 1)];
+        ROBOEYES_COMMAND_TRACE(cmd);
+        if (cmd.op == CMD_POSITION) gaze = cmd.a;
+        else applyCommand(cmd);
+        tail++;
+      }
+      commandTail.store(tail, std::memory_order_release);
+      if (gaze >= 0) setPosition(gaze);
+#endif
+    }
+
+    void applyCommand(const Command &cmd) {
+      switch (cmd.op) {
+        case CMD_WIDTH:       setWidth(cmd.a, cmd.b); break;
+        case CMD_HEIGHT:      setHeight(cmd.a, cmd.b); break;
+        case CMD_RADIUS:      setBorderradius(cmd.a, cmd.b); break;
+        case CMD_SPACE:       setSpacebetween((int16_t)cmd.c); break;
+        case CMD_MOOD:        setMood(cmd.a); break;
+        case CMD_POSITION:    setPosition(cmd.a); break;
+        case CMD_AUTOBLINKER: setAutoblinker(cmd.a, (int16_t)cmd.c, (int16_t)cmd.d); break;
+        case CMD_IDLEMODE:    setIdleMode(cmd.a, (int16_t)cmd.c, (int16_t)cmd.d); break;
+        case CMD_CURIOSITY:   setCuriosity(cmd.a); break;
+        case CMD_CYCLOPS:     setCyclops(cmd.a); break;
+        case CMD_HFLICKER:
+          if (cmd.a & 2) setHFlicker(cmd.a & 1, (uint8_t)cmd.b);
+          else { hFlicker = cmd.a & 1; wake(); }  // one-argument overload
+          break;
+        case CMD_VFLICKER:
+          if (cmd.a & 2) setVFlicker(cmd.a & 1, (uint8_t)cmd.b);
+          else { vFlicker = cmd.a & 1; wake(); }  // one-argument overload
+          break;
+        case CMD_COLORS:      setColors(cmd.c, cmd.d); break;
+        case CMD_CLOSE:       close(cmd.a, cmd.b); break;
+        case CMD_OPEN:        open(cmd.a, cmd.b); break;
+        case CMD_BLINK:       blink(cmd.a, cmd.b); break;
+        case CMD_CONFUSED:    anim_confused(); break;
+        case CMD_LAUGH:       anim_laugh(); break;
+        case CMD_PLAY:
+          if (cmd.b) crossfadeClip(cmd.clip, cmd.c, cmd.a);
+          else playClip(cmd.clip, cmd.c, cmd.a);
+          break;
+        case CMD_STOP:        stopClip(cmd.clip, cmd.c); break;
+        case CMD_FADE:        fadeColors(cmd.c, cmd.d, cmd.a | (cmd.b << 8)); break;
+        case CMD_OVERLAY:     invalidateOverlay(cmd.a); break;
+        case CMD_BACKGROUND:  invalidateBackground(cmd.a); break;
       }
-      if (blinkingActive && millis() >= blinkCloseDurationTimer) {
-        open();
-        blinkingActive = false;
+    }
+
+    // ---------------------------
+    // Clip playback helpers
+
+    // Little-endian 16-bit word, from PROGMEM or RAM
+    static uint16_t readWord(const uint8_t *p) {
+      return pgm_read_byte(p) | (pgm_read_byte(p + 1) << 8);
+    }
+
+    bool clipsPlaying() {
+      for (uint8_t s = 0; s < ROBOEYES_CLIP_SLOTS; s++) {
+        if (clipSlots[s].clip) return true;
       }
+      return false;
+    }
 
-      if (laugh) {
-        if (laughToggle) {
-          setVFlicker(true, 5);
-          laughAnimationTimer = millis();
-          laughToggle = false;
-        } else if (millis() >= laughAnimationTimer + laughAnimationDuration) {
-          setVFlicker(false, 0);
-          laughToggle = true;
-          laugh = false;
+    // Value of a track with count keys at time t (ms into the pass)
+    static int32_t trackValue(const uint8_t *keys, uint8_t count, uint8_t curve, uint16_t t) {
+      if (count == 0) return 0;
+      uint16_t t0 = readWord(keys);
+      int32_t v0 = (int16_t)readWord(keys + 2);
+      if (t <= t0) return v0;
+      for (uint8_t k = 1; k < count; k++) {
+        uint16_t t1 = readWord(keys + k * 4);
+        int32_t v1 = (int16_t)readWord(keys + k * 4 + 2);
+        if (t < t1) {
+          if (curve == ROBOEYES_CURVE_STEP) return v0;
+          int32_t f = ((int32_t)(t - t0) << 8) / (t1 - t0);  // 0..256
+          switch (curve) {
+            case ROBOEYES_CURVE_EASE_IN:     f = (f * f) >> 8; break;
+            case ROBOEYES_CURVE_EASE_OUT:    f = 256 - (((256 - f) * (256 - f)) >> 8); break;
+            case ROBOEYES_CURVE_EASE_IN_OUT: f = (f * f * (768 - 2 * f)) >> 16; break;
+          }
+          return v0 + (((v1 - v0) * f) >> 8);
         }
+        t0 = t1;
+        v0 = v1;
       }
+      return v0;
+    }
 
-      if (confused) {
-        if (confusedToggle) {
-          setHFlicker(true, 20);
-          confusedAnimationTimer = millis();
-          confusedToggle = false;
-        } else if (millis() >= confusedAnimationTimer + confusedAnimationDuration) {
-          setHFlicker(false, 0);
-          confusedToggle = true;
-          confused = false;
+    // Sum every playing clip's tracks at time now into clipValue, weighted
+    // by its fade in/out. Clips that ended or faded out free their slot.
+    void evalClips(unsigned long now) {
+      memset(clipValue, 0, sizeof(clipValue));
+      for (uint8_t s = 0; s < ROBOEYES_CLIP_SLOTS; s++) {
+        ClipSlot &slot = clipSlots[s];
+        if (!slot.clip) continue;
+        const uint8_t *p = slot.clip;
+        unsigned long t = now - slot.start;
+        uint16_t length = readWord(p + 4);
+        uint8_t loops = pgm_read_byte(p + 6);
+        if (loops && t >= (unsigned long)length * loops) { slot.clip = nullptr; continue; }
+        int32_t weight = 256;
+        if (t < slot.blendIn) weight = t * 256 / slot.blendIn;
+        if (slot.stopping) {
+          unsigned long out = now - slot.stopStart;
+          if (out >= slot.blendOut) { slot.clip = nullptr; continue; }
+          weight = (weight * (int32_t)(256 - out * 256 / slot.blendOut)) >> 8;
         }
+
+        uint16_t local = length ? t % length : 0;
+        uint8_t trackCount = pgm_read_byte(p + 3);
+        p += 8;
+        for (uint8_t k = 0; k < trackCount; k++) {
+          uint8_t param = pgm_read_byte(p), curve = pgm_read_byte(p + 1);
+          uint8_t mask = pgm_read_byte(p + 2), keys = pgm_read_byte(p + 3);
+          p += 4;
+          int32_t v = (trackValue(p, keys, curve, local) * weight) / 256;
+          mask = (mask ? mask : 0xFF) & slot.eyeMask;
+          if (param < ROBOEYES_CLIP_PARAMS) {
+            for (uint8_t i = 0; i < eye.count; i++) {
+              if (mask & (1 << i)) clipValue[param][i] += v;
+            }
+          }
+          p += keys * 4;
+        }
+      }
+    }
+
+    // Lid height target: the mood's, plus clip offsets in percent of half
+    // the eye height, kept within the eye
+    int lidTarget(uint8_t i, bool active, int half, uint8_t param) {
+      int target = (active ? half : 0) + half * clipValue[param][i] / 100;
+      return max(0, min(target, eye.heightCurrent[i]));
+    }
+
+    // ---------------------------
+    // Statistics helpers (compile to nothing when ROBOEYES_STATS is 0)
+
+    uint32_t statClock() {
+#if ROBOEYES_STATS
+      return ROBOEYES_MICROS();
+#else
+      return 0;
+#endif
+    }
+
+    void recordFrame(uint32_t tStart, uint32_t tRendered, unsigned long lateMs) {
+#if ROBOEYES_STATS
+      FrameRecord &r = statFrames[statHead];
+      r.renderUs = tRendered - tStart;
+      r.pushUs = statClock() - tRendered;
+      r.pixels = pixelsPushed;
+      r.lateMs = lateMs > 0xFFFF ? 0xFFFF : lateMs;
+      statHead = (statHead + 1) % ROBOEYES_STATS_FRAMES;
+      if (statCount < ROBOEYES_STATS_FRAMES) statCount++;
+#else
+      (void)tStart; (void)tRendered; (void)lateMs;
+#endif
+    }
+
+    // min/avg/p99/max of n values (sorts them in place)
+    static void summarize(uint32_t *values, uint16_t n, RoboEyesStat &out) {
+      if (n == 0) return;
+      uint64_t sum = 0;
+      for (uint16_t i = 1; i < n; i++) {  // insertion sort, n is small
+        uint32_t v = values[i];
+        int16_t k = i - 1;
+        while (k >= 0 && values[k] > v) { values[k + 1] = values[k]; k--; }
+        values[k + 1] = v;
       }
+      for (uint16_t i = 0; i < n; i++) sum += values[i];
+      out.min = values[0];
+      out.max = values[n - 1];
+      out.avg = sum / n;
+      out.p99 = values[((uint32_t)n * 99 + 99) / 100 - 1];
+    }
+
+    static void printStat(Print &out, const char *name, const RoboEyesStat &s) {
+      out.print(name);
+      out.print(" ");
+      out.print(s.min);
+      out.print(" / ");
+      out.print(s.avg);
+      out.print(" / ");
+      out.print(s.p99);
+      out.print(" / ");
+      out.println(s.max);
+    }
+
+    // ---------------------------
+    // Gaze helpers
 
-      if (idle) {
-        if (millis() >= idleAnimationTimer) {
-          eyeLxNext = random(getScreenConstraint_X());
-          eyeLyNext = random(getScreenConstraint_Y());
-          idleAnimationTimer = millis() + (idleInterval * 1000UL) + (random(idleIntervalVariation) * 1000UL);
+    // Take the newest gaze sample, if any, and aim the eyes at where the
+    // target is expected to be gazeLead ms from now
+    void pollGaze(unsigned long now) {
+      uint32_t seq = gazeSeq;
+      if (seq != gazeSeen && !(seq & 1)) {
+        uint32_t sample = gazeSample;
+        unsigned long t = gazeSampleTime;
+        if (gazeSeq == seq) {  // not overwritten while reading
+          gazeSeen = seq;
+          int32_t x = sample >> 16, y = sample & 0xFFFF;
+          const int32_t jump = 65535L * ROBOEYES_GAZE_SACCADE / 1000;
+          if (!gazeActive || abs(x - gazeX) > jump || abs(y - gazeY) > jump) {
+            gazeSaccade = gazeActive;
+            gazeVX = gazeVY = 0;
+          } else if (t != gazeTime) {
+            long dt = t - gazeTime;
+            gazeVX = (gazeVX + (x - gazeX) * 256 / dt) / 2;
+            gazeVY = (gazeVY + (y - gazeY) * 256 / dt) / 2;
+          }
+          gazeX = x;
+          gazeY = y;
+          gazeTime = t;
+          gazeActive = gazeFresh = true;
         }
       }
+      if (!gazeActive) return;
 
-      if (hFlicker) {
-        if (hFlickerAlternate) {
-          eyeLx += hFlickerAmplitude;
-          eyeRx += hFlickerAmplitude;
-        } else {
-          eyeLx -= hFlickerAmplitude;
-          eyeRx -= hFlickerAmplitude;
+      long age = max((long)(now - gazeTime), 0L);
+      if (age > ROBOEYES_GAZE_TIMEOUT) {
+        gazeActive = false;
+        return;
+      }
+      long ahead = min(age + gazeLead, 200L);  // extrapolate no further than this
+      long x = gazeX + (long)(((int64_t)gazeVX * ahead) >> 8);
+      long y = gazeY + (long)(((int64_t)gazeVY * ahead) >> 8);
+      aimLeads(max(0L, min(x, 65535L)), 65535, max(0L, min(y, 65535L)), 65535);
+    }
+
+    // ---------------------------
+    // Time and random helpers
+
+    unsigned long clockMillis() {
+      return clockMsFn ? clockMsFn() : millis();
+    }
+
+    unsigned long clockMicros() {
+      if (clockUsFn) return clockUsFn();
+      return clockMsFn ? clockMsFn() * 1000UL : micros();
+    }
+
+    // Like random(n): 0 .. n - 1, or 0 if n <= 0
+    long randomBelow(long n) {
+      if (randomState == 0) return random(n);
+      randomState ^= randomState << 13;
+      randomState ^= randomState >> 17;
+      randomState ^= randomState << 5;
+      return n > 0 ? randomState % n : 0;
+    }
+
+    // Call emit(x, y, w, color) for the runs of rows [y0, y1) (default: all)
+    // of a surface's last frame on the panel, left to right and top to
+    // bottom
+    template <typename Emit>
+    void frameRows(const Surface &sf, Emit emit, int y0 = 0, int y1 = -1) {
+      int16_t spans[6 * ROBOEYES_MAX_EYES][2];
+      const int scale = renderScale;
+      if (y1 < 0 || y1 > sf.height) y1 = sf.height;
+      if (hasLayers(sf)) {
+        // Layers are not known from the shapes: read the frame back from
+        // the buffer pushed last
+        TFT_eSprite *frame = doubleBuffered ? sf.buffers[sf.drawBuffer ^ 1] : sf.sprite;
+        for (int yy = y0; yy < y1; yy++) {
+          int x0 = 0;
+          uint16_t run = frame->readPixel(0, yy / scale);
+          for (int x = 1; x <= sf.width; x++) {
+            uint16_t color = x < sf.width ? frame->readPixel(x / scale, yy / scale) : ~run;
+            if (color == run) continue;
+            emit(x0, yy, x - x0, run);
+            x0 = x;
+            run = color;
+          }
         }
-        hFlickerAlternate = !hFlickerAlternate;
+        return;
+      }
+      for (int yy = y0; yy < y1; yy++) {
+        uint8_t count = (this->*rowSpansFn)(sf, yy / scale, spans);
+        int cursor = 0;
+        for (uint8_t i = 0; i < count; i++) {
+          int s0 = max(spans[i][0] * scale, cursor);
+          int s1 = min(spans[i][1] * scale, sf.width);
+          if (s1 <= s0) continue;
+          if (s0 > cursor) emit(cursor, yy, s0 - cursor, bgColor);
+          emit(s0, yy, s1 - s0, mainColor);
+          cursor = s1;
+        }
+        if (cursor < sf.width) emit(cursor, yy, sf.width - cursor, bgColor);
       }
+    }
 
-      if (vFlicker) {
-        if (vFlickerAlternate) {
-          eyeLy += vFlickerAmplitude;
-          eyeRy += vFlickerAmplitude;
-        } else {
-          eyeLy -= vFlickerAmplitude;
-          eyeRy -= vFlickerAmplitude;
+#if ROBOEYES_MIRROR
+    // ---------------------------
+    // Mirror stream encoder (format: see setMirror())
+
+    // Write one record for a surface's frame just pushed: the rows its
+    // dirty regions cover, or all of them for a keyframe
+    void mirrorFrame(const Surface &sf) {
+      mirrorSinceKey++;
+      if (mirrorFailed && mirrorSinceKey < mirrorKeyInterval) return;  // wait before trying again
+      bool key = mirrorNeedKey || (mirrorKeyInterval && mirrorSinceKey >= mirrorKeyInterval);
+
+      // Changed rows as sorted, merged panel row ranges
+      int ranges[ROBOEYES_MAX_EYES + 1][2];
+      uint8_t count = 0;
+      if (key) {
+        ranges[count][0] = 0;
+        ranges[count++][1] = sf.height;
+      } else {
+        for (uint8_t i = 0; i < sf.dirtyCount; i++) {
+          int y0 = max(0, sf.dirtyRects[i].y * renderScale);
+          int y1 = min(sf.height, (sf.dirtyRects[i].y + sf.dirtyRects[i].h) * renderScale);
+          if (y1 <= y0) continue;
+          uint8_t k = count++;
+          while (k > 0 && ranges[k - 1][0] > y0) {
+            ranges[k][0] = ranges[k - 1][0]; ranges[k][1] = ranges[k - 1][1];
+            k--;
+          }
+          ranges[k][0] = y0; ranges[k][1] = y1;
         }
-        vFlickerAlternate = !vFlickerAlternate;
+        uint8_t merged = 0;
+        for (uint8_t i = 0; i < count; i++) {
+          if (merged && ranges[i][0] <= ranges[merged - 1][1]) {
+            ranges[merged - 1][1] = max(ranges[merged - 1][1], ranges[i][1]);
+          } else {
+            ranges[merged][0] = ranges[i][0]; ranges[merged][1] = ranges[i][1];
+            merged++;
+          }
+        }
+        count = merged;
+        if (!count) return;
       }
 
-      if (cyclops) {
-        eyeRwidthCurrent = 0;
-        eyeRheightCurrent = 0;
-        spaceBetweenCurrent = 0;
+      if (key) mirrorColors = 0;
+      uint8_t colors = mirrorColors;
+
+      // Send none of the record if the sink cannot take it all now, so
+      // update() never waits on the sink. Bounds of its size settle most
+      // frames; the rest are sized by running the encoder without output.
+      int room = mirrorOut->availableForWrite();
+      if (room > 0) {
+        uint32_t least, most;
+        mirrorBounds(sf, ranges, count, least, most);
+        if ((uint32_t)room < least) {
+          mirrorFailed = true;  // not even close: back off as if it were gone
+          mirrorNeedKey = true;
+          mirrorSinceKey = 0;
+          mirrorDropped++;
+          return;
+        }
+        if ((uint32_t)room < most) {
+          mirrorSizing = true;
+          mirrorSize = 0;
+          mirrorRecord(sf, key, ranges, count);
+          mirrorSizing = false;
+          mirrorColors = colors;
+          if ((uint32_t)room < mirrorSize) {
+            mirrorNeedKey = true;
+            mirrorDropped++;
+            return;
+          }
+        }
+      }
+
+      mirrorRecord(sf, key, ranges, count);
+      if (mirrorFailed) {
+        mirrorColors = colors;  // nothing the decoder can rely on was sent
+        mirrorNeedKey = true;
+        mirrorSinceKey = 0;
+        return;
+      }
+      mirrorCount++;
+      mirrorNeedKey = false;
+      if (key) mirrorSinceKey = 0;
+    }
+
+    // Least and most bytes a record of these ranges takes: header, range
+    // words and checksum, plus per row at least one run, at most one per
+    // pixel, each a literal color, with a length word per 16 pixels
+    void mirrorBounds(const Surface &sf, const int (*ranges)[2], uint8_t count, uint32_t &least, uint32_t &most) {
+      uint32_t rows = 0;
+      for (uint8_t i = 0; i < count; i++) rows += ranges[i][1] - ranges[i][0];
+      least = 12 + 4 * count + 2;
+      most = least + rows * (3 * sf.width + 2 * (sf.width / 16 + 1));
+      least += rows;
+    }
+
+    // Encode and write (or only size) the record of a frame
+    void mirrorRecord(const Surface &sf, bool key, const int (*ranges)[2], uint8_t count) {
+      mirrorFailed = false;
+      mirrorFill = 0;
+      mirrorSumA = mirrorSumB = 0;
+      mirrorPut('R', false);
+      mirrorPut('M', false);
+      mirrorPut(ROBOEYES_MIRROR_VERSION);
+      mirrorPut(key ? 'K' : 'D');
+      mirrorPut((uint8_t)(&sf - surfaces));
+      mirrorWord(mirrorCount);
+      mirrorWord(sf.width);
+      mirrorWord(sf.height);
+      mirrorPut(count);
+      mirrorFlush();  // a sink that is gone fails here, before any encoding
+      for (uint8_t i = 0; i < count && !mirrorFailed; i++) {
+        mirrorWord(ranges[i][0]);
+        mirrorWord(ranges[i][1] - ranges[i][0]);
+        frameRows(sf, [&](int, int, int w, uint16_t color) { mirrorRun(w, color); },
+                  ranges[i][0], ranges[i][1]);
+      }
+      uint16_t sum = (mirrorSumB << 8) | mirrorSumA;
+      mirrorWord(sum);
+      mirrorFlush();
+    }
+
+    // One run of w pixels: a color index, or the color itself the first
+    // time it is seen
+    void mirrorRun(int w, uint16_t color) {
+      if (mirrorFailed) return;
+      uint8_t index = 0;
+      while (index < mirrorColors && mirrorPalette[index] != color) index++;
+      bool literal = index == mirrorColors;
+      if (literal) {
+        if (mirrorColors < 15) mirrorPalette[mirrorColors++] = color;
+        index = 15;
+      }
+      mirrorPut((w <= 15 ? (w - 1) << 4 : 0xF0) | index);
+      if (w > 15) mirrorWord(w);
+      if (literal) mirrorWord(color);
+    }
+
+    void mirrorWord(uint16_t v) {
+      mirrorPut(v & 0xFF);
+      mirrorPut(v >> 8);
+    }
+
+    void mirrorPut(uint8_t b, bool summed = true) {
+      if (mirrorSizing) {
+        mirrorSize++;
+        return;
+      }
+      if (summed) {
+        mirrorSumA = (mirrorSumA + b) % 255;
+        mirrorSumB = (mirrorSumB + mirrorSumA) % 255;
+      }
+      mirrorBuffer[mirrorFill++] = b;
+      if (mirrorFill == ROBOEYES_MIRROR_BUFFER) mirrorFlush();
+    }
+
+    void mirrorFlush() {
+      if (mirrorFill && !mirrorFailed) {
+        size_t n = mirrorOut->write(mirrorBuffer, mirrorFill);
+        mirrorBytes += n;
+        mirrorFailed = n < mirrorFill;
+      }
+      mirrorFill = 0;
+    }
+#endif
+
+    // ---------------------------
+    // Frame pacing helpers
+
+    // Something changed: if the scheduler is idling, run a frame right away.
+    // Easing restarts from one frame interval ago, so the time spent idle
+    // does not land in that frame's step.
+    void wake() {
+      unsigned long now = ROBOEYES_MILLIS();
+      if ((long)(nextFrameTime - now) > frameInterval) {
+        nextFrameTime = now;
+        easeTimer = now - frameInterval;
       }
+    }
+
+    // Earliest pending timer that will change the eyes without a setter
+    unsigned long nextTimerEvent(unsigned long now) {
+      unsigned long event = now + 60000UL;
+      if (autoblinker && (long)(blinktimer - event) < 0) event = blinktimer;
+      if (idle && (long)(idleAnimationTimer - event) < 0) event = idleAnimationTimer;
+      return event;
+    }
 
-      // --- ACTUAL DRAWINGS ---
-      // Instead of clearing the TFT, clear the sprite to the background color.
-      sprite->fillSprite(bgColor);
+    // ---------------------------
+    // Static-frame state (see FrameState)
+    static void hashInt(uint32_t &h, int32_t v) {
+      for (uint8_t i = 0; i < 4; i++) {
+        h ^= (uint8_t)(v >> (i * 8));
+        h *= 16777619UL;
+      }
+    }
 
-      // Draw eyes onto the sprite
-      sprite->fillRoundRect(eyeLx, eyeLy, eyeLwidthCurrent, eyeLheightCurrent, eyeLborderRadiusCurrent, mainColor);
-      if (!cyclops) {
-        sprite->fillRoundRect(eyeRx, eyeRy, eyeRwidthCurrent, eyeRheightCurrent, eyeRborderRadiusCurrent, mainColor);
+    // Shape as seen from (dx, dy), in at most SHAPE_WORDS words; returns
+    // the end of what was written
+    static int32_t *packShape(int32_t *w, const EyeShape &e, int dx = 0, int dy = 0) {
+      *w++ = e.x - dx; *w++ = e.y - dy; *w++ = e.w; *w++ = e.h; *w++ = e.r;
+      *w++ = e.happyX - dx; *w++ = e.happyY - dy;
+      *w++ = e.happyW; *w++ = e.happyH; *w++ = e.happyR;
+      *w++ = e.wedgeCount;
+      for (uint8_t k = 0; k < e.wedgeCount; k++) {
+        *w++ = e.wedges[k].x0 - dx; *w++ = e.wedges[k].x1 - dx;
+        *w++ = e.wedges[k].h; *w++ = e.wedges[k].anchorLeft;
       }
+      return w;
+    }
 
-      // Prepare mood transitions: tired, angry, happy
-      if (tired) { 
-        eyelidsTiredHeightNext = eyeLheightCurrent / 2; 
-        eyelidsAngryHeightNext = 0; 
-      } else { 
-        eyelidsTiredHeightNext = 0; 
+    void packFrame(const Surface &sf, FrameState &state) {
+      int32_t *w = state.words;
+      for (uint8_t k = 0; k < sf.eyeCount; k++) {
+        w = packShape(w, eye.shape[sf.eyes[k]]);
+      }
+      *w++ = ((uint32_t)mainColor << 16) | bgColor;
+      *w++ = (hFlicker && hFlickerAlternate) | ((vFlicker && vFlickerAlternate) << 1);
+#if ROBOEYES_TEXTURE
+      for (uint8_t k = 0; textured && k < sf.eyeCount; k++) {
+        for (uint8_t l = 0; l < ROBOEYES_TEXTURE_LAYERS; l++) {
+          const TexturePlacement &p = texturePlaced[sf.eyes[k]][l];
+          *w++ = p.x; *w++ = p.y; *w++ = p.w; *w++ = p.h;
+        }
       }
-      if (angry) { 
-        eyelidsAngryHeightNext = eyeLheightCurrent / 2; 
-        eyelidsTiredHeightNext = 0; 
-      } else { 
-        eyelidsAngryHeightNext = 0; 
+#endif
+      state.count = w - state.words;
+      state.digest = 2166136261UL;
+      for (uint16_t i = 0; i < state.count; i++) hashInt(state.digest, state.words[i]);
+    }
+
+    static bool sameFrame(const FrameState &a, const FrameState &b) {
+      return a.digest == b.digest && a.count == b.count &&
+             memcmp(a.words, b.words, a.count * sizeof(int32_t)) == 0;
+    }
+
+    // ---------------------------
+    // Color helpers
+
+    // Show new colors. 1- and 4-bit frame buffers hold palette indices, so
+    // the frame only needs to be sent again; otherwise it is redrawn.
+    void applyColors(uint16_t main, uint16_t background) {
+      if (main == mainColor && background == bgColor) return;
+      mainColor = main;
+      bgColor = background;
+      updateInks();
+      for (uint8_t s = 0; s < surfaceCount; s++) {
+        if (surfaces[s].layer) drawBackground(surfaces[s]);  // cleared to bgColor
       }
-      if (happy) { 
-        eyelidsHappyBottomOffsetNext = eyeLheightCurrent / 2; 
-      } else { 
-        eyelidsHappyBottomOffsetNext = 0; 
+      if ((colorDepth == 1 || colorDepth == 4) && bandCount == 0) repaintAll = true;
+      else fullRedraw = true;
+      wake();
+    }
+
+    // RGB565 color num/den of the way from a to b
+    static uint16_t blend565(uint16_t a, uint16_t b, int num, int den) {
+      int r = (a >> 11) + ((b >> 11) - (a >> 11)) * num / den;
+      int g = ((a >> 5) & 0x3F) + (((b >> 5) & 0x3F) - ((a >> 5) & 0x3F)) * num / den;
+      int bl = (a & 0x1F) + ((b & 0x1F) - (a & 0x1F)) * num / den;
+      return (r << 11) | (g << 5) | bl;
+    }
+
+    // Move a color fade to the gradient step for time now
+    void stepFade(unsigned long now) {
+      if (!fading) return;
+      unsigned long t = now - fadeStart;
+      uint8_t i = ROBOEYES_FADE_STEPS - 1;
+      if (t < fadeDuration) i = t * ROBOEYES_FADE_STEPS / fadeDuration;
+      else fading = false;
+      applyColors(fadeLut[0][i], fadeLut[1][i]);
+    }
+
+    // ---------------------------
+    // Color depth helpers
+
+    // Smallest frame buffer depth that can hold every color in use
+    uint8_t autoColorDepth() {
+      if (overlayCount) return 16;  // layers bring colors of their own
+#if ROBOEYES_TEXTURE
+      if (hasTextures()) return 16;
+#endif
+      for (uint8_t s = 0; s < surfaceCount; s++) {
+        if (hasBackground(surfaces[s])) return 16;
       }
+      uint8_t colors = (mainColor == bgColor) ? 1 : 2;
+      return colors <= 2 ? 1 : (colors <= 16 ? 4 : 16);
+    }
 
-      // Tired eyelids
-      eyelidsTiredHeight = (eyelidsTiredHeight + eyelidsTiredHeightNext) / 2;
-      if (!cyclops) {
-        sprite->fillTriangle(eyeLx, eyeLy - 1, eyeLx + eyeLwidthCurrent, eyeLy - 1,
-                              eyeLx, eyeLy + eyelidsTiredHeight - 1, bgColor);
-        sprite->fillTriangle(eyeRx, eyeRy - 1, eyeRx + eyeRwidthCurrent, eyeRy - 1,
-                              eyeRx + eyeRwidthCurrent, eyeRy + eyelidsTiredHeight - 1, bgColor);
+    // Depth begin() gives the frame buffers: 16 bits for DMA double
+    // buffering (pushImageDMA only takes RGB565 data), else the set or
+    // smallest sufficient depth
+    uint8_t frameDepth() {
+      if (doubleBuffered) return 16;
+      return colorDepthSetting ? colorDepthSetting : autoColorDepth();
+    }
+
+    // Map mainColor/bgColor to what is stored in the frame buffer: palette
+    // indices for 1/4-bit buffers (palettes updated here), colors otherwise.
+    void updateInks() {
+      if (colorDepth == 1 || colorDepth == 4) {
+        inkBg = 0;
+        inkMain = 1;
+        palette[0] = bgColor;
+        palette[1] = mainColor;
+        for (uint8_t s = 0; s < surfaceCount; s++) {
+          TFT_eSprite *sprite = surfaces[s].sprite;
+          if (sprite && colorDepth == 1) sprite->setBitmapColor(mainColor, bgColor);
+          if (sprite && colorDepth == 4) sprite->createPalette(palette, 16);
+        }
       } else {
-        sprite->fillTriangle(eyeLx, eyeLy - 1, eyeLx + (eyeLwidthCurrent / 2), eyeLy - 1,
-                              eyeLx, eyeLy + eyelidsTiredHeight - 1, bgColor);
-        sprite->fillTriangle(eyeLx + (eyeLwidthCurrent / 2), eyeLy - 1, eyeLx + eyeLwidthCurrent, eyeLy - 1,
-                              eyeLx + eyeLwidthCurrent, eyeLy + eyelidsTiredHeight - 1, bgColor);
-      }
-
-      // Angry eyelids
-      eyelidsAngryHeight = (eyelidsAngryHeight + eyelidsAngryHeightNext) / 2;
-      if (!cyclops) {
-        sprite->fillTriangle(eyeLx, eyeLy - 1, eyeLx + eyeLwidthCurrent, eyeLy - 1,
-                              eyeLx + eyeLwidthCurrent, eyeLy + eyelidsAngryHeight - 1, bgColor);
-        sprite->fillTriangle(eyeRx, eyeRy - 1, eyeRx + eyeRwidthCurrent, eyeRy - 1,
-                              eyeRx, eyeRy + eyelidsAngryHeight - 1, bgColor);
+        inkBg = bgColor;
+        inkMain = mainColor;
+      }
+    }
+
+    // ---------------------------
+    // Easing helpers
+
+    // Copy the integer animation state into the fixed-point accumulators
+    void easeSync() {
+      for (uint8_t i = 0; i < eye.count; i++) {
+        easeAcc[EASE_WIDTH][i] = (int32_t)eye.widthCurrent[i] << 8;
+        easeAcc[EASE_HEIGHT][i] = (int32_t)eye.heightCurrent[i] << 8;
+        easeAcc[EASE_RADIUS][i] = (int32_t)eye.radiusCurrent[i] << 8;
+        easeAcc[EASE_X][i] = (int32_t)eye.x[i] << 8;
+        easeAcc[EASE_Y][i] = (int32_t)eye.y[i] << 8;
+        easeAcc[EASE_TIRED][i] = (int32_t)eye.tiredHeight[i] << 8;
+        easeAcc[EASE_ANGRY][i] = (int32_t)eye.angryHeight[i] << 8;
+        easeAcc[EASE_HAPPY][i] = (int32_t)eye.happyOffset[i] << 8;
+      }
+      easeSpace = (int32_t)spaceBetweenCurrent << 8;
+    }
+
+    // Work out this frame's gain = 1 - 2^(-dt / halfLife) in Q12
+    void easeStep(unsigned long now) {
+      // 2^(-i/16) in Q16, i = 0..16
+      static const uint32_t pow2Table[17] = {
+        65536, 62757, 60097, 57549, 55109, 52773, 50535, 48393, 46341,
+        44376, 42495, 40693, 38968, 37316, 35734, 34219, 32768
+      };
+      unsigned long dt = now - easeTimer;
+      easeTimer = now;
+      // After a stall (slow loop(), missed deadlines) move at most a few
+      // frames' worth, so the eyes do not jump in one frame
+      if (dt > 3UL * frameInterval) dt = 3UL * frameInterval;
+      uint32_t n = (uint32_t)(dt << 8) / easeHalfLife;  // exponent in 1/256
+      uint32_t whole = n >> 8, idx = (n >> 4) & 15, rem = n & 15;
+      int32_t keep = pow2Table[idx] - (((int32_t)(pow2Table[idx] - pow2Table[idx + 1]) * (int32_t)rem) >> 4);
+      keep = whole >= 16 ? 0 : keep >> whole;
+      easeGain = (uint16_t)((65536 - keep) >> 4);
+    }
+
+    // Move one accumulator towards target by this frame's gain; returns the
+    // rounded value. Within half a pixel it snaps onto the target.
+    int ease(int32_t &acc, int target) {
+      int32_t goal = (int32_t)target << 8;
+      int32_t diff = goal - acc;
+      if (diff > -128 && diff < 128) acc = goal;
+      else acc += (diff * easeGain) >> 12;
+      return (acc + 128) >> 8;
+    }
+
+    static void easeSnap(int32_t &acc, int value) {
+      acc = (int32_t)value << 8;
+    }
+
+    // ---------------------------
+    // Dirty-region helpers
+    static Rect unionRect(const Rect &a, const Rect &b) {
+      if (a.empty()) return b;
+      if (b.empty()) return a;
+      int x0 = min(a.x, b.x), y0 = min(a.y, b.y);
+      int x1 = max(a.x + a.w, b.x + b.w), y1 = max(a.y + a.h, b.y + b.h);
+      return Rect{x0, y0, x1 - x0, y1 - y0};
+    }
+
+    static Rect intersectRect(const Rect &a, const Rect &b) {
+      int x0 = max(a.x, b.x), y0 = max(a.y, b.y);
+      int x1 = min(a.x + a.w, b.x + b.w), y1 = min(a.y + a.h, b.y + b.h);
+      return Rect{x0, y0, x1 - x0, y1 - y0};
+    }
+
+    static bool overlaps(const Rect &a, const Rect &b) {
+      return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+    }
+
+    // Clip to a surface's frame buffer (in frame buffer pixels)
+    Rect clipToScreen(const Surface &sf, const Rect &r) {
+      int x0 = max(r.x, 0), y0 = max(r.y, 0);
+      int x1 = min(r.x + r.w, rasterWidth(sf)), y1 = min(r.y + r.h, rasterHeight(sf));
+      return Rect{x0, y0, x1 - x0, y1 - y0};
+    }
+
+    // Largest corner radius that fits a w x h box
+    static int clampRadius(int r, int w, int h) {
+      int limit = min(w, h) / 2;
+      return r > limit ? max(limit, 0) : r;
+    }
+
+    // Add r to a surface's dirty list, merged with any region it overlaps
+    // so no pixel is pushed twice
+    static void addDirty(Surface &sf, Rect r) {
+      uint8_t i = 0;
+      while (i < sf.dirtyCount) {
+        if (overlaps(r, sf.dirtyRects[i])) {
+          r = unionRect(r, sf.dirtyRects[i]);
+          sf.dirtyRects[i] = sf.dirtyRects[--sf.dirtyCount];
+          i = 0;  // the grown region may now reach earlier ones
+        } else {
+          i++;
+        }
+      }
+      sf.dirtyRects[sf.dirtyCount++] = r;
+    }
+
+    // Build a surface's dirty list from the previous and current boxes of
+    // its eyes. With double buffering the buffer being drawn last held the
+    // frame before the previous one, so its old eyes are erased as well.
+    template <class Spec>
+    void markDirty(Surface &sf) {
+      sf.dirtyCount = 0;
+      bool full = sf.bufferStale[sf.drawBuffer];
+      if (full) {
+        sf.dirtyRects[sf.dirtyCount++] = fullRect<Spec>(sf);
+        sf.bufferStale[sf.drawBuffer] = false;
+      }
+      for (uint8_t k = 0; k < sf.eyeCount; k++) {
+        uint8_t i = sf.eyes[k];
+        const EyeShape &e = eye.shape[i];
+        Rect cur = {e.x, e.y, e.w, e.h};
+        if (!full) {
+          Rect r = unionRect(eye.box[i], cur);
+          if (doubleBuffered) r = unionRect(r, eye.boxOld[i]);
+          r = clipToScreen(sf, r);
+          if (!r.empty()) addDirty(sf, r);
+        }
+        eye.boxOld[i] = eye.box[i];
+        eye.box[i] = cur;
+      }
+      // Invalidated overlays
+      Rect &o = sf.overlayDirty[sf.drawBuffer];
+      if (!full && !o.empty()) {
+        Rect r = clipToScreen(sf, o);
+        if (!r.empty()) addDirty(sf, r);
+      }
+      o = Rect{0, 0, 0, 0};
+    }
+
+    // A background layer, an overlay or textured eyes on a surface with a
+    // frame buffer
+    bool hasLayers(const Surface &sf) {
+      if (!sf.sprite || bandCount) return false;
+      if (sf.layer) return true;
+#if ROBOEYES_TEXTURE
+      if (textured && sf.eyeCount) return true;
+#endif
+      for (uint8_t j = 0; j < overlayCount; j++) {
+        if (&surfaces[overlays[j].surface] == &sf) return true;
+      }
+      return false;
+    }
+
+    // Draw the overlays of a surface where they meet its dirty regions,
+    // the sprite's viewport clipped to each part
+    void drawOverlays(Surface &sf) {
+      for (uint8_t j = 0; j < overlayCount; j++) {
+        const Overlay &o = overlays[j];
+        if (&surfaces[o.surface] != &sf) continue;
+        for (uint8_t i = 0; i < sf.dirtyCount; i++) {
+          Rect r = intersectRect(o.bounds, sf.dirtyRects[i]);
+          if (r.empty()) continue;
+          sf.sprite->setViewport(r.x, r.y, r.w, r.h, false);
+          o.draw(*sf.sprite, o.arg);
+          sf.sprite->resetViewport();
+        }
+      }
+    }
+
+    // Push the dirty regions of a surface's sprite to the same place on its display
+    void pushDirtyRects(Surface &sf) {
+      for (uint8_t i = 0; i < sf.dirtyCount; i++) {
+        const Rect &d = sf.dirtyRects[i];
+        pushRect(sf, d, d.y);
+      }
+    }
+
+    // Push region r of the frame (held in sprite rows from spriteY) to its
+    // place on the panel. Scaled frames are streamed as runs of one color,
+    // each sprite pixel widened to renderScale pixels and each row sent
+    // renderScale times.
+    void pushRect(Surface &sf, const Rect &r, int spriteY) {
+      if (renderScale == 1) {
+        sf.sprite->pushSprite(r.x, r.y, r.x, spriteY, r.w, r.h);
+        pixelsPushed += (uint32_t)r.w * r.h;
+        return;
+      }
+      const int scale = renderScale;
+      int x0 = r.x * scale, y0 = r.y * scale;
+      int w = min(r.w * scale, sf.width - x0), h = min(r.h * scale, sf.height - y0);
+      if (w <= 0 || h <= 0) return;
+      sf.tft->startWrite();
+      sf.tft->setAddrWindow(x0, y0, w, h);
+      for (int j = 0; j < h; j++) {
+        int sy = spriteY + j / scale;
+        uint16_t color = sf.sprite->readPixel(r.x, sy);
+        int start = 0;
+        for (int i = 1; i <= r.w; i++) {
+          uint16_t next = i < r.w ? sf.sprite->readPixel(r.x + i, sy) : ~color;
+          if (next == color) continue;
+          sf.tft->pushBlock(color, min(i * scale, w) - start);
+          start = i * scale;
+          color = next;
+        }
+      }
+      sf.tft->endWrite();
+      pixelsPushed += (uint32_t)w * h;
+    }
+
+    // Frame buffer size of a surface: the panel divided by renderScale
+    int rasterWidth(const Surface &sf) {
+      return (sf.width + renderScale - 1) / renderScale;
+    }
+    int rasterHeight(const Surface &sf) {
+      return (sf.height + renderScale - 1) / renderScale;
+    }
+
+    // The whole frame buffer of a surface
+    template <class Spec>
+    Rect fullRect(const Surface &sf) {
+      return Rect{0, 0, (specWidth<Spec>(sf) + renderScale - 1) / renderScale,
+                  (specHeight<Spec>(sf) + renderScale - 1) / renderScale};
+    }
+
+    // Rows held by a surface's sprite: one band in band mode, else the whole screen
+    int spriteRows(Surface &sf) {
+      int rows = rasterHeight(sf);
+      if (bandCount == 0) return rows;
+      sf.bandHeight = (rows + bandCount - 1) / bandCount;
+      return sf.bandHeight;
+    }
+
+    // Bytes per row of a sprite w pixels wide (rows start on a byte)
+    static uint32_t rowBytes(int w, uint8_t depth) {
+      switch (depth) {
+        case 1:  return (w + 7) / 8;
+        case 4:  return (w + 1) / 2;
+        case 16: return w * 2;
+        default: return w;
+      }
+    }
+
+    // Bytes of one frame buffer for a w x h panel at depth bits
+    uint32_t bufferBytes(int w, int h, uint8_t depth) {
+      w = (w + renderScale - 1) / renderScale;
+      h = (h + renderScale - 1) / renderScale;
+      if (bandCount) h = (h + bandCount - 1) / bandCount;
+      return rowBytes(w, depth) * h;
+    }
+
+    // Memory per frame buffer: room for either orientation, rounded up so
+    // the next buffer stays word aligned
+    uint32_t bufferCapacity(int w, int h, uint8_t depth) {
+      uint32_t a = bufferBytes(w, h, depth), b = bufferBytes(h, w, depth);
+      return ((a > b ? a : b) + 3) & ~(uint32_t)3;
+    }
+
+    // Heap memory for begin(), from PSRAM when the board has it and psram
+    uint8_t *allocMemory(uint32_t bytes, bool psram) {
+      uint8_t *memory = nullptr;
+#if defined(BOARD_HAS_PSRAM)
+      if (psram) memory = (uint8_t *)ps_malloc(bytes);
+#else
+      (void)psram;
+#endif
+      if (!memory) memory = (uint8_t *)malloc(bytes);
+      return memory;
+    }
+
+    // Give a surface its frame buffer memory - the next slice of caller
+    // storage from offset, else one allocation - and construct its
+    // sprite(s) on it. DMA buffers stay out of PSRAM.
+    bool allocSurface(Surface &sf, uint32_t &offset) {
+      uint8_t count = bufferCount(sf);
+      uint32_t capacity = bufferCapacity(sf.width, sf.height, colorDepth);
+      if (frameStorage) {
+        if (offset + capacity * count > frameStorageBytes) return false;
+        sf.memory = frameStorage + offset;
+        offset += capacity * count;
       } else {
-        sprite->fillTriangle(eyeLx, eyeLy - 1, eyeLx + (eyeLwidthCurrent / 2), eyeLy - 1,
-                              eyeLx + (eyeLwidthCurrent / 2), eyeLy + eyelidsAngryHeight - 1, bgColor);
-        sprite->fillTriangle(eyeLx + (eyeLwidthCurrent / 2), eyeLy - 1, eyeLx + eyeLwidthCurrent, eyeLy - 1,
-                              eyeLx + eyeLwidthCurrent, eyeLy + eyelidsAngryHeight - 1, bgColor);
+        sf.memory = allocMemory(capacity * count, !doubleBuffered);
+        if (!sf.memory) return false;
+        sf.ownsMemory = true;
       }
+      sf.capacity = capacity;
+      for (uint8_t i = 0; i < (doubleBuffered ? 2 : 1); i++) {
+        sf.buffers[i] = new (sf.spriteStore[i]) RoboEyesSprite(sf.tft);
+        sf.buffers[i]->setColorDepth(colorDepth);
+      }
+      sf.drawBuffer = 0;
+      sf.sprite = sf.buffers[0];
+      attachSurface(sf);
+      if (doubleBuffered) {
+        sf.tft->initDMA();
+        sf.tft->startWrite();  // chip select stays low, the eyes own the bus
+      }
+      return true;
+    }
+
+    // Frame buffers of a surface plus its background layer, if it has one
+    uint8_t bufferCount(const Surface &sf) {
+      return (doubleBuffered ? 2 : 1) + (hasBackground(sf) ? 1 : 0);
+    }
+
+    bool hasBackground(const Surface &sf) {
+      return (sf.backgroundImage || sf.backgroundDraw) && bandCount == 0;
+    }
 
-      // Happy (bottom) eyelids
-      eyelidsHappyBottomOffset = (eyelidsHappyBottomOffset + eyelidsHappyBottomOffsetNext) / 2;
-      sprite->fillRoundRect(eyeLx - 1, (eyeLy + eyeLheightCurrent) - eyelidsHappyBottomOffset + 1,
-                              eyeLwidthCurrent + 2, eyeLheightDefault, eyeLborderRadiusCurrent, bgColor);
-      if (!cyclops) {
-        sprite->fillRoundRect(eyeRx - 1, (eyeRy + eyeRheightCurrent) - eyelidsHappyBottomOffset + 1,
-                              eyeRwidthCurrent + 2, eyeRheightDefault, eyeRborderRadiusCurrent, bgColor);
+    // Point a surface's sprite(s) at its memory at the current size, clear
+    // them and draw the background layer
+    void attachSurface(Surface &sf) {
+      const uint8_t frames = doubleBuffered ? 2 : 1;
+      sf.stride = rowBytes(rasterWidth(sf), colorDepth);
+      for (uint8_t i = 0; i < frames; i++) {
+        sf.buffers[i]->attach(sf.memory + i * sf.capacity, rasterWidth(sf), spriteRows(sf), palette);
+        clearBuffer(sf.memory + i * sf.capacity, sf.stride * spriteRows(sf));
       }
-    } // end drawEyes
+      sf.pixels = sf.memory + sf.drawBuffer * sf.capacity;
+      sf.layer = hasBackground(sf) ? sf.memory + frames * sf.capacity : nullptr;
+      if (sf.layer) drawBackground(sf);
+      sf.bufferInFlight[0] = sf.bufferInFlight[1] = false;
+      sf.bufferStale[0] = sf.bufferStale[1] = true;
+    }
+
+    // Draw a surface's background layer: bgColor, then the image or the
+    // callback, through the first sprite lent to the layer's memory
+    void drawBackground(Surface &sf) {
+      RoboEyesSprite &sprite = *sf.buffers[0];
+      const int w = rasterWidth(sf), h = rasterHeight(sf), scale = renderScale;
+      clearBuffer(sf.layer, sf.stride * h);
+      sprite.attach(sf.layer, w, h, palette);
+      if (sf.backgroundImage) {
+        for (int y = 0; y < h; y++) {
+          const uint16_t *row = sf.backgroundImage + (uint32_t)y * scale * sf.width;
+          for (int x = 0; x < w; x++) sprite.drawPixel(x, y, pgm_read_word(row + x * scale));
+        }
+      }
+      if (sf.backgroundDraw) sf.backgroundDraw(sprite, sf.backgroundArg);
+      sprite.attach(sf.memory, w, spriteRows(sf), palette);
+    }
+
+    // Destroy every sprite and free the memory begin() allocated
+    void freeBuffers() {
+      for (uint8_t s = 0; s < surfaceCount; s++) {
+        freeSurface(surfaces[s]);
+      }
+#if ROBOEYES_CACHE
+      if (cacheArena != cacheStorage) free(cacheArena);
+      cacheArena = nullptr;
+      cacheCount = 0;
+      cacheUsed = 0;
+#endif
+#if ROBOEYES_TEXTURE
+      if (textureArena != textureStorage) free(textureArena);
+      textureArena = nullptr;
+      textureVariantCount = 0;
+      textureUsed = 0;
+      textured = false;
+#endif
+      ready = false;
+    }
+
+    // Destroy a surface's sprite(s) and free its memory if begin() allocated it
+    void freeSurface(Surface &sf) {
+      if (!sf.buffers[0]) return;
+      if (doubleBuffered) {
+        sf.tft->dmaWait();  // never free a buffer the DMA is still reading
+        sf.tft->endWrite();
+        sf.tft->deInitDMA();
+      }
+      for (uint8_t i = 0; i < 2; i++) {
+        if (sf.buffers[i]) sf.buffers[i]->~RoboEyesSprite();
+        sf.buffers[i] = nullptr;
+      }
+      sf.sprite = nullptr;
+      sf.pixels = nullptr;
+      sf.layer = nullptr;
+      sf.replay = nullptr;
+      if (sf.ownsMemory) free(sf.memory);
+      sf.memory = nullptr;
+      sf.capacity = 0;
+      sf.ownsMemory = false;
+    }
+
+    // New dimensions for a surface: re-center its eyes and re-point its
+    // frame buffer(s). Their memory is only replaced when the new size
+    // does not fit, which caller storage cannot do.
+    bool resizeSurface(Surface &sf, int w, int h) {
+      if (sf.buffers[0] && bufferBytes(w, h, colorDepth) > sf.capacity) {
+        if (!sf.ownsMemory) return false;
+        uint8_t count = bufferCount(sf);
+        uint32_t capacity = bufferCapacity(w, h, colorDepth);
+        uint8_t *memory = allocMemory(capacity * count, !doubleBuffered);
+        if (!memory) return false;
+        if (doubleBuffered) sf.tft->dmaWait();
+        free(sf.memory);
+        sf.memory = memory;
+        sf.capacity = capacity;
+      }
+      sf.width = w;
+      sf.height = h;
+      // Recalculate default positions for centering the eyes and head
+      // there for a smooth transition
+      relayout();
+      for (uint8_t k = 0; k < sf.eyeCount; k++) {
+        uint8_t i = sf.eyes[k];
+        eye.xNext[i] = eye.xDefault[i];
+        eye.yNext[i] = eye.yDefault[i];
+      }
+      if (sf.buffers[0]) {
+        if (doubleBuffered) sf.tft->dmaWait();
+        attachSurface(sf);
+        updateInks();
+      }
+      fullRedraw = true;
+      return true;
+    }
+
+    // Band mode: for each band, rasterize the parts of the dirty regions
+    // that fall inside it into the band sprite and push just those parts.
+    void pushBands(Surface &sf) {
+      const int rows = rasterHeight(sf);
+      for (int by = 0; by < rows; by += sf.bandHeight) {
+        Rect band = {0, by, rasterWidth(sf), min(sf.bandHeight, rows - by)};
+        Rect parts[ROBOEYES_MAX_EYES];
+        uint8_t partCount = 0;
+        for (uint8_t i = 0; i < sf.dirtyCount; i++) {
+          const Rect &d = sf.dirtyRects[i];
+          if (overlaps(d, band)) {
+            int y0 = max(d.y, band.y);
+            int y1 = min(d.y + d.h, band.y + band.h);
+            parts[partCount++] = Rect{d.x, y0, d.w, y1 - y0};
+          }
+        }
+        if (partCount == 0) continue;  // nothing changed in this band
+
+        rasterOriginY = by;
+        rasterRects(sf, parts, partCount);
+        for (uint8_t i = 0; i < partCount; i++) {
+          pushRect(sf, parts[i], parts[i].y - by);
+        }
+      }
+      rasterOriginY = 0;
+    }
+
+    // Point the renderer at a surface's next ping-pong buffer. Fence: a
+    // buffer that may still be streaming to the panel is never drawn into.
+    void selectDrawBuffer(Surface &sf) {
+      if (sf.bufferInFlight[sf.drawBuffer]) {
+        sf.tft->dmaWait();
+        sf.bufferInFlight[0] = sf.bufferInFlight[1] = false;
+      }
+      sf.sprite = sf.buffers[sf.drawBuffer];
+      sf.pixels = sf.memory + sf.drawBuffer * sf.capacity;
+    }
+
+    // Queue the dirty rows of a surface's current buffer for DMA and flip
+    // buffers. Sprite rows are contiguous, so the dirty regions are widened
+    // to a full-width band that can be sent as one transfer.
+    void pushDMA(Surface &sf) {
+      if (sf.dirtyCount > 0) {
+        int y0 = sf.dirtyRects[0].y, y1 = sf.dirtyRects[0].y + sf.dirtyRects[0].h;
+        for (uint8_t i = 1; i < sf.dirtyCount; i++) {
+          y0 = min(y0, sf.dirtyRects[i].y);
+          y1 = max(y1, sf.dirtyRects[i].y + sf.dirtyRects[i].h);
+        }
+        uint16_t *pixels = (uint16_t *)sf.sprite->getPointer() + (uint32_t)y0 * sf.width;
+        // pushImageDMA() waits for the previous transfer before queuing this one
+        sf.tft->pushImageDMA(0, y0, sf.width, y1 - y0, pixels);
+        sf.bufferInFlight[sf.drawBuffer] = true;
+        pixelsPushed += (uint32_t)sf.width * (y1 - y0);
+      }
+      sf.drawBuffer ^= 1;
+    }
 
 }; // end class TFT_RoboEyes
 
+// ---------------------------
+// Compile-time specialized variant for a fixed panel and feature set.
+// Screen size and frame buffer depth are constants of the renderer, and
+// moods/modes missing from Features (ROBOEYES_FEATURE_* bits) are
+// compiled out of the per-frame geometry and the scanline loop, e.g.
+//   RoboEyes<240, 135, 1, ROBOEYES_FEATURE_TIRED | ROBOEYES_FEATURE_HAPPY> eyes(tft, 3);
+// The setters of disabled features still compile but have no effect.
+// Depth 0 keeps the depth picked in begin(); a 1, 4 or 8-bit Depth rules
+// out double buffering, which needs 16-bit buffers.
+template <int Width, int Height, uint8_t Depth = 0, uint16_t Features = ROBOEYES_FEATURE_ALL>
+class RoboEyes : public TFT_RoboEyes {
+  public:
+    static_assert(Width > 0 && Height > 0, "RoboEyes: screen size must be positive");
+    static_assert(Depth == 0 || Depth == 1 || Depth == 4 || Depth == 8 || Depth == 16,
+                  "RoboEyes: Depth must be 0 (auto), 1, 4, 8 or 16");
+
+    RoboEyes(TFT_eSPI &display, int rotation = 1)
+      : TFT_RoboEyes(display, Width < Height, rotation, Width, Height, Depth,
+                     &RoboEyes::template drawEyesT<RoboEyesSpec<Features, Width, Height, Depth> >,
+                     &RoboEyes::template rasterRowT<RoboEyesSpec<Features, Width, Height, Depth> >,
+                     &RoboEyes::template rowSpans<RoboEyesSpec<Features, Width, Height, Depth> >) {
+    }
+
+    void setDoubleBuffered(bool active) {
+      TFT_RoboEyes::setDoubleBuffered(active && (Depth == 0 || Depth == 16));
+    }
+
+  private:
+    // Size and depth are template parameters, and one panel of that size
+    // is all the renderer draws
+    bool setScreenSize(int w, int h);
+    void setColorDepth(uint8_t bits);
+    int8_t addSurface(TFT_eSPI &display, int w, int h);
+};
+
 #endif
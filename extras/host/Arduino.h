@@ -0,0 +1,87 @@
+/*
+ * Host stand-in for the parts of the Arduino core RoboEyesTFT_eSPI.h uses.
+ * Time only moves when the harness sets it: hostMillis/hostMicros are
+ * what millis()/micros() return. random() draws from rand(), seeded with
+ * randomSeed().
+ */
+
+#ifndef _ROBOEYES_HOST_ARDUINO_H
+#define _ROBOEYES_HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+using std::max;
+using std::min;
+
+typedef uint8_t byte;
+
+#define PROGMEM
+#define IRAM_ATTR
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+
+#define INPUT 0
+#define LOW 0
+
+// ---------------------------
+// Injectable clock and random source
+
+inline unsigned long hostMillis = 0;
+inline unsigned long hostMicros = 0;
+
+// Move the clock forward, keeping millis() and micros() in step
+inline void hostAdvance(unsigned long ms) {
+  hostMillis += ms;
+  hostMicros += ms * 1000UL;
+}
+
+inline unsigned long millis() { return hostMillis; }
+inline unsigned long micros() { return hostMicros; }
+inline void delay(unsigned long ms) { hostAdvance(ms); }
+inline void yield() {}
+
+inline void randomSeed(unsigned long seed) { srand((unsigned)seed); }
+inline long random(long n) { return n > 0 ? rand() % n : 0; }
+inline long random(long lo, long hi) { return hi > lo ? lo + rand() % (hi - lo) : lo; }
+
+inline void pinMode(int, int) {}
+inline int digitalRead(int) { return 1; }
+
+// ---------------------------
+// Print / Stream
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+    virtual size_t write(const uint8_t *buffer, size_t size) {
+      size_t n = 0;
+      while (n < size && write(buffer[n])) n++;
+      return n;
+    }
+    virtual int availableForWrite() { return 0; }  // as Arduino's: room not known
+
+    size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(long v) { char b[24]; snprintf(b, sizeof(b), "%ld", v); return print(b); }
+    size_t print(unsigned long v) { char b[24]; snprintf(b, sizeof(b), "%lu", v); return print(b); }
+    size_t print(int v) { return print((long)v); }
+    size_t print(unsigned int v) { return print((unsigned long)v); }
+    size_t println() { return print("\r\n"); }
+    template <typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+};
+
+class Stream : public Print {
+  public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+};
+
+#endif
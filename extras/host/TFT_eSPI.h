@@ -0,0 +1,354 @@
+/*
+ * Host stand-in for TFT_eSPI / TFT_eSprite: the calls RoboEyesTFT_eSPI.h
+ * makes, drawing into memory. TFT_eSPI keeps the panel as an RGB565
+ * framebuffer (fb) and counts the pixels sent to it. A DMA transfer stays
+ * in flight until it is waited for, and counts it when its source buffer
+ * is written to in the meantime. TFT_eSprite keeps TFT_eSPI 2.x's
+ * protected member names and memory layout at 1, 4, 8 and 16 bits, so
+ * RoboEyesSprite and the span kernels work on it unchanged.
+ */
+
+#ifndef _ROBOEYES_HOST_TFT_ESPI_H
+#define _ROBOEYES_HOST_TFT_ESPI_H
+
+#include "Arduino.h"
+#include <vector>
+
+#define TFT_BLACK 0x0000
+#define TFT_WHITE 0xFFFF
+#define TFT_RED 0xF800
+#define TFT_GREEN 0x07E0
+#define TFT_BLUE 0x001F
+#define TFT_CYAN 0x07FF
+#define TFT_YELLOW 0xFFE0
+
+// LilyGo TTGO T-Display panel, portrait
+#ifndef TFT_WIDTH
+#define TFT_WIDTH 135
+#endif
+#ifndef TFT_HEIGHT
+#define TFT_HEIGHT 240
+#endif
+
+class TFT_eSPI : public Print {
+  public:
+    std::vector<uint16_t> fb;  // panel pixels, row major, panelWidth wide
+    int panelWidth, panelHeight;
+    unsigned long pixelsPushed = 0;  // pixels sent to the panel so far
+
+    TFT_eSPI(int16_t w = TFT_WIDTH, int16_t h = TFT_HEIGHT) : panelWidth(w), panelHeight(h) {
+      fb.assign(w * h, 0);
+    }
+
+    void init() {}
+    void setRotation(uint8_t r) {
+      rotation = r & 3;
+      bool landscape = rotation & 1;
+      if (landscape != (panelWidth > panelHeight)) std::swap(panelWidth, panelHeight);
+      fb.assign(panelWidth * panelHeight, 0);
+    }
+    int16_t width() { return panelWidth; }
+    int16_t height() { return panelHeight; }
+    uint16_t color565(uint8_t r, uint8_t g, uint8_t b) {
+      return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+    }
+
+    void setSwapBytes(bool swap) { swapBytes = swap; }
+    bool getSwapBytes() { return swapBytes; }
+    void setBitmapColor(uint16_t, uint16_t) {}
+    void setViewport(int32_t, int32_t, int32_t, int32_t, bool = true) {}
+    void setPivot(int16_t, int16_t) {}
+
+    // Bus and DMA. pushImageDMA() snapshots its source and returns; the
+    // transfer reaches the panel on dmaWait(), before the next transfer
+    // or bus write, or after dmaPolls calls of dmaBusy(). A source that
+    // changes before then counts in dmaOverwrites.
+    int dmaPolls = 3;
+    unsigned long dmaTransfers = 0, dmaOverwrites = 0;
+
+    void startWrite() {}
+    void endWrite() {}
+    bool initDMA(bool = false) { return true; }
+    void deInitDMA() { dmaWait(); }
+    bool dmaBusy() {
+      if (dmaPending && --dmaPollsLeft <= 0) dmaWait();
+      return dmaPending;
+    }
+    void dmaWait() {
+      if (!dmaPending) return;
+      dmaPending = false;
+      if (memcmp(dmaSource, dmaData.data(), dmaData.size() * 2)) dmaOverwrites++;
+      setAddrWindow(dmaX, dmaY, dmaW, dmaH);
+      for (uint16_t v : dmaData) put(swap16(v));  // sprite data is byte swapped, as on the device
+    }
+
+    // The panel as it will be once the transfer in flight has landed,
+    // without waiting for it
+    std::vector<uint16_t> shown() const {
+      std::vector<uint16_t> panel = fb;
+      if (!dmaPending) return panel;
+      for (int32_t i = 0; i < dmaW * dmaH; i++) {
+        int32_t x = dmaX + i % dmaW, y = dmaY + i / dmaW;
+        if (x >= 0 && y >= 0 && x < panelWidth && y < panelHeight) panel[y * panelWidth + x] = swap16(dmaData[i]);
+      }
+      return panel;
+    }
+
+    void setAddrWindow(int32_t x, int32_t y, int32_t w, int32_t h) {
+      dmaWait();
+      winX = x;
+      winY = y;
+      winW = w;
+      winPos = 0;
+      (void)h;
+    }
+    void pushPixels(const void *data, uint32_t len) {
+      const uint16_t *p = (const uint16_t *)data;
+      for (uint32_t i = 0; i < len; i++) put(swapBytes ? swap16(p[i]) : p[i]);
+    }
+    void pushBlock(uint16_t color, uint32_t len) {
+      while (len--) put(color);
+    }
+    void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data) {
+      setAddrWindow(x, y, w, h);
+      pushPixels(data, w * h);
+    }
+    void pushImageDMA(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data, uint16_t * = nullptr) {
+      dmaWait();
+      dmaX = x;
+      dmaY = y;
+      dmaW = w;
+      dmaH = h;
+      dmaSource = data;
+      dmaData.assign(data, data + w * h);
+      dmaPollsLeft = dmaPolls;
+      dmaPending = true;
+      dmaTransfers++;
+    }
+
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+      dmaWait();
+      for (int32_t j = max(y, 0); j < min(y + h, (int32_t)panelHeight); j++)
+        for (int32_t i = max(x, 0); i < min(x + w, (int32_t)panelWidth); i++) fb[j * panelWidth + i] = color;
+    }
+    void fillScreen(uint32_t color) { fillRect(0, 0, panelWidth, panelHeight, color); }
+    void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) { fillRect(x, y, w, 1, color); }
+
+    size_t write(uint8_t) { return 1; }
+
+    static uint16_t swap16(uint16_t v) { return (uint16_t)((v >> 8) | (v << 8)); }
+
+  protected:
+    int32_t cursor_x = 0, cursor_y = 0;
+    uint8_t rotation = 0;
+    bool swapBytes = false;
+    int32_t winX = 0, winY = 0, winW = 1;
+    long winPos = 0;
+    bool dmaPending = false;
+    int dmaPollsLeft = 0;
+    int32_t dmaX = 0, dmaY = 0, dmaW = 0, dmaH = 0;
+    const uint16_t *dmaSource = nullptr;
+    std::vector<uint16_t> dmaData;  // what the transfer sends
+
+    // Next pixel of the address window
+    void put(uint16_t color) {
+      int32_t x = winX + winPos % winW, y = winY + winPos / winW;
+      winPos++;
+      if (x >= 0 && y >= 0 && x < panelWidth && y < panelHeight) fb[y * panelWidth + x] = color;
+      pixelsPushed++;
+    }
+};
+
+class TFT_eSprite : public TFT_eSPI {
+  public:
+    explicit TFT_eSprite(TFT_eSPI *tft) : _tft(tft) {}
+    ~TFT_eSprite() { deleteSprite(); }
+
+    void setColorDepth(int8_t bpp) { _bpp = bpp; }
+    int8_t getColorDepth() { return _bpp; }
+
+    void *createSprite(int16_t w, int16_t h, uint8_t = 1) {
+      if (_created) return _img8;
+      _dwidth = _iwidth = _bitwidth = w;
+      _dheight = _iheight = h;
+      if (_bpp == 1) _iwidth = _bitwidth = (w + 7) & ~7;
+      if (_bpp == 4) _iwidth = (w + 1) & ~1;
+      _img8 = _img8_1 = _img8_2 = _img4 = (uint8_t *)calloc((size_t)_iwidth * h * _bpp / 8 + 1, 1);
+      if (!_img8) return nullptr;
+      _img = (uint16_t *)_img8;
+      if (_bpp == 4 && !_colorMap) {
+        _colorMap = (uint16_t *)calloc(16, sizeof(uint16_t));
+        for (int i = 0; i < 16; i++) _colorMap[i] = i * 0x1111;
+      }
+      _created = true;
+      resetViewport();
+      return _img8;
+    }
+    void deleteSprite() {
+      if (_colorMap) free(_colorMap);
+      _colorMap = nullptr;
+      if (_created) free(_img8_1);
+      _img8 = _img8_1 = _img8_2 = _img4 = nullptr;
+      _img = nullptr;
+      _created = false;
+    }
+    bool created() { return _created; }
+    void *getPointer() { return _img8; }
+    int16_t width() { return _dwidth; }
+    int16_t height() { return _dheight; }
+
+    void setBitmapColor(uint16_t fg, uint16_t bg) {
+      bitmapFg = fg;
+      bitmapBg = bg;
+    }
+    void createPalette(const uint16_t *colors, uint8_t n = 16) {
+      if (!_created) return;
+      if (!_colorMap) _colorMap = (uint16_t *)calloc(16, sizeof(uint16_t));
+      for (int i = 0; i < n && i < 16; i++) _colorMap[i] = colors ? colors[i] : 0;
+    }
+    void setPaletteColor(uint8_t index, uint16_t color) { _colorMap[index & 15] = color; }
+    uint16_t getPaletteColor(uint8_t index) { return _colorMap[index & 15]; }
+
+    void setViewport(int32_t x, int32_t y, int32_t w, int32_t h, bool = true) {
+      _vx = x;
+      _vy = y;
+      _vw = x + w;
+      _vh = y + h;
+    }
+    void resetViewport() {
+      _vx = _vy = 0;
+      _vw = _dwidth;
+      _vh = _dheight;
+    }
+
+    void drawPixel(int32_t x, int32_t y, uint32_t color) {
+      if (x < _vx || y < _vy || x >= _vw || y >= _vh || !_img8) return;
+      if (x < 0 || y < 0 || x >= _dwidth || y >= _dheight) return;
+      switch (_bpp) {
+        case 16:
+          _img[y * _iwidth + x] = swap16((uint16_t)color);
+          break;
+        case 8:
+          _img8[y * _iwidth + x] = to332(color);
+          break;
+        case 4: {
+          uint8_t *p = &_img4[(y * _iwidth + x) >> 1];
+          *p = (x & 1) ? (*p & 0xF0) | (color & 15) : (*p & 0x0F) | ((color & 15) << 4);
+          break;
+        }
+        default: {
+          uint8_t *p = &_img8[(y * _bitwidth + x) >> 3];
+          uint8_t mask = 0x80 >> (x & 7);
+          *p = color ? *p | mask : *p & ~mask;
+        }
+      }
+    }
+    uint16_t readPixel(int32_t x, int32_t y) {
+      if (x < 0 || y < 0 || x >= _dwidth || y >= _dheight || !_img8) return 0;
+      switch (_bpp) {
+        case 16:
+          return swap16(_img[y * _iwidth + x]);
+        case 8:
+          return from332(_img8[y * _iwidth + x]);
+        case 4: {
+          uint8_t b = _img4[(y * _iwidth + x) >> 1];
+          return _colorMap[(x & 1) ? (b & 15) : (b >> 4)];
+        }
+        default:
+          return (_img8[(y * _bitwidth + x) >> 3] & (0x80 >> (x & 7))) ? bitmapFg : bitmapBg;
+      }
+    }
+
+    void fillSprite(uint32_t color) { fillRect(0, 0, _dwidth, _dheight, color); }
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+      for (int32_t j = y; j < y + h; j++)
+        for (int32_t i = x; i < x + w; i++) drawPixel(i, j, color);
+    }
+    void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) { fillRect(x, y, w, 1, color); }
+    void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color) { fillRect(x, y, 1, h, color); }
+
+    // Same span decomposition as TFT_eSPI, so overdraw counts match
+    void fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color) {
+      fillRect(x, y + r, w, h - r - r, color);
+      fillCircleHelper(x + r, y + h - r - 1, r, 1, w - r - r - 1, color);
+      fillCircleHelper(x + r, y + r, r, 2, w - r - r - 1, color);
+    }
+    void fillTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color) {
+      if (y0 > y1) { std::swap(y0, y1); std::swap(x0, x1); }
+      if (y1 > y2) { std::swap(y2, y1); std::swap(x2, x1); }
+      if (y0 > y1) { std::swap(y0, y1); std::swap(x0, x1); }
+      if (y0 == y2) {
+        int32_t a = min(x0, min(x1, x2)), b = max(x0, max(x1, x2));
+        drawFastHLine(a, y0, b - a + 1, color);
+        return;
+      }
+      int32_t dx01 = x1 - x0, dy01 = y1 - y0, dx02 = x2 - x0, dy02 = y2 - y0, dx12 = x2 - x1, dy12 = y2 - y1;
+      int32_t sa = 0, sb = 0, y = y0, last = (y1 == y2) ? y1 : y1 - 1;
+      for (; y <= last; y++) {
+        int32_t a = x0 + sa / dy01, b = x0 + sb / dy02;
+        sa += dx01;
+        sb += dx02;
+        if (a > b) std::swap(a, b);
+        drawFastHLine(a, y, b - a + 1, color);
+      }
+      sa = dx12 * (y - y1);
+      sb = dx02 * (y - y0);
+      for (; y <= y2; y++) {
+        int32_t a = x1 + sa / dy12, b = x0 + sb / dy02;
+        sa += dx12;
+        sb += dx02;
+        if (a > b) std::swap(a, b);
+        drawFastHLine(a, y, b - a + 1, color);
+      }
+    }
+
+    void pushSprite(int32_t x, int32_t y) { pushSprite(x, y, 0, 0, _dwidth, _dheight); }
+    bool pushSprite(int32_t tx, int32_t ty, int32_t sx, int32_t sy, int32_t sw, int32_t sh) {
+      _tft->setAddrWindow(tx, ty, sw, sh);
+      for (int32_t j = 0; j < sh; j++)
+        for (int32_t i = 0; i < sw; i++) _tft->pushBlock(readPixel(sx + i, sy + j), 1);
+      return true;
+    }
+
+    static uint8_t to332(uint16_t c) {
+      return ((c & 0xE000) >> 8) | ((c & 0x0700) >> 6) | ((c & 0x0018) >> 3);
+    }
+    static uint16_t from332(uint8_t c) {
+      uint16_t r = c & 0xE0, g = c & 0x1C, b = c & 3;
+      return (r << 8) | ((r << 5) & 0x1800) | (g << 6) | ((g << 3) & 0x00E0) | (b << 3) | (b << 1) | (b >> 1);
+    }
+
+  protected:
+    TFT_eSPI *_tft;
+    int8_t _bpp = 16;
+    bool _created = false;
+    uint16_t *_img = nullptr;
+    uint8_t *_img8 = nullptr, *_img4 = nullptr, *_img8_1 = nullptr, *_img8_2 = nullptr;
+    uint16_t *_colorMap = nullptr;
+    int32_t _iwidth = 0, _iheight = 0, _dwidth = 0, _dheight = 0, _bitwidth = 0;
+    int32_t _sx = 0, _sy = 0;
+    uint32_t _sw = 0, _sh = 0, _scolor = 0;
+    int32_t _vx = 0, _vy = 0, _vw = 0, _vh = 0;  // viewport, clips drawPixel()
+    uint16_t bitmapFg = TFT_WHITE, bitmapBg = TFT_BLACK;
+
+    void fillCircleHelper(int32_t x0, int32_t y0, int32_t r, uint8_t corners, int32_t delta, uint32_t color) {
+      int32_t f = 1 - r, ddF_x = 1, ddF_y = -r - r, y = 0;
+      delta++;
+      while (y < r) {
+        if (f >= 0) {
+          if (corners & 1) drawFastHLine(x0 - y, y0 + r, y + y + delta, color);
+          if (corners & 2) drawFastHLine(x0 - y, y0 - r, y + y + delta, color);
+          r--;
+          ddF_y += 2;
+          f += ddF_y;
+        }
+        y++;
+        ddF_x += 2;
+        f += ddF_x;
+        if (corners & 1) drawFastHLine(x0 - r, y0 + y, r + r + delta, color);
+        if (corners & 2) drawFastHLine(x0 - r, y0 - y, r + r + delta, color);
+      }
+    }
+};
+
+#endif
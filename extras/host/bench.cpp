@@ -0,0 +1,401 @@
+// Render benchmarks on the host stand-in. Each section prints one table:
+//
+//   moods     render and push time, pixels written and overdraw for every
+//             mood / cyclops / flicker combination, then dumpStats()
+//   depths    frame buffer bytes, render and push time at 1, 4, 8 and
+//             16 bits
+//   scale     frame buffer bytes, pixels written and pushed, render and
+//             push time at render scale 1, 2 and 4
+//   kernels   span fill rate of the kernels against TFT_eSprite's
+//             per-pixel drawFastHLine() loop
+//   cache     render time with the expression cache off and on
+//   textures  render time of flat and textured eyes
+//   gaze      gaze_trace.txt replayed through setGaze() with prediction
+//             off and on: getGazeLatency(), input-to-pixels latency and
+//             tracking error
+//
+// Frame times come from getStats(), timed on the host's wall clock while
+// the eyes run on the simulated one, over every update() of a run (frames
+// found unchanged included). "fps" is the frame rate p99 render and push
+// times would allow.
+//
+// Usage: bench [section ...] (default: all). Times are wall clock on the
+// host and only compare runs with each other; they say nothing about an
+// ESP32.
+
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static unsigned long wallMicros() {
+  static const Clock::time_point start = Clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+}
+#define ROBOEYES_MICROS() wallMicros()
+#define ROBOEYES_STATS_FRAMES 4000  // a whole run
+#include "RoboEyesTFT_eSPI.h"
+
+static double nsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+static double fps(const RoboEyesStats &stats) {
+  return 1e6 / max(stats.renderUs.p99 + stats.pushUs.p99, (uint32_t)1);
+}
+
+// ---------------------------
+// moods
+
+static void benchMoods() {
+  static const char *moods[] = {"default", "tired", "angry", "happy"};
+  static const char *flickers[] = {"-", "h", "v"};
+  printf("%-8s %-7s %-7s %9s %5s %7s %5s %7s %12s %9s\n", "mood", "cyclops", "flicker", "render us", "p99",
+         "push us", "p99", "fps", "written/frm", "overdraw");
+  for (int mood = DEFAULT; mood <= HAPPY; mood++)
+    for (int cyclops = 0; cyclops < 2; cyclops++)
+      for (int flicker = 0; flicker < 3; flicker++) {
+        hostMillis = hostMicros = 0;
+        randomSeed(1);
+        TFT_eSPI tft;
+        TFT_RoboEyes eyes(tft, false, 3);
+        eyes.begin(50);
+        eyes.setAutoblinker(true, 1, 1);
+        eyes.setIdleMode(true, 1, 1);
+        eyes.setMood(mood);
+        eyes.setCyclops(cyclops);
+        if (flicker == 1) eyes.setHFlicker(true, 2);
+        if (flicker == 2) eyes.setVFlicker(true, 2);
+
+        unsigned long long written = 0, overdraw = 0;
+        unsigned frames = 0;
+        for (int f = 0; f < 3000; f++) {
+          hostAdvance(20);
+          eyes.update();
+          if (eyes.isIdle()) continue;
+          written += eyes.getPixelsWritten();
+          overdraw += eyes.getOverdraw();
+          frames++;
+        }
+        if (!frames) frames = 1;
+        RoboEyesStats stats = eyes.getStats();
+        printf("%-8s %-7s %-7s %9u %5u %7u %5u %7.0f %12llu %8.2fx\n", moods[mood], cyclops ? "yes" : "no",
+               flickers[flicker], stats.renderUs.avg, stats.renderUs.p99, stats.pushUs.avg, stats.pushUs.p99,
+               fps(stats), written / frames, overdraw / 100.0 / frames);
+        if (mood == HAPPY && cyclops && flicker == 2) {
+          Print out;  // stdout
+          printf("\ndumpStats() of the last run:\n");
+          eyes.dumpStats(out);
+        }
+      }
+}
+
+// ---------------------------
+// depths
+
+// Flicker keeps every frame moving, so each update() renders
+static void benchDepths() {
+  printf("%-6s %9s %9s %5s %7s %5s %7s\n", "depth", "fb bytes", "render us", "p99", "push us", "p99", "fps");
+  for (uint8_t depth : {1, 4, 8, 16}) {
+    hostMillis = hostMicros = 0;
+    randomSeed(1);
+    TFT_eSPI tft;
+    TFT_RoboEyes eyes(tft, false, 3);
+    eyes.setColorDepth(depth);
+    eyes.begin(50);
+    eyes.setAutoblinker(true, 1, 1);
+    eyes.setIdleMode(true, 1, 1);
+    eyes.setHFlicker(true, 2);
+    for (int f = 0; f < 3000; f++) {
+      hostAdvance(20);
+      if (f % 200 == 0) eyes.setMood(f / 200 % 4);
+      eyes.update();
+    }
+    RoboEyesStats stats = eyes.getStats();
+    printf("%-6u %9u %9u %5u %7u %5u %7.0f\n", depth, eyes.getFramebufferBytes(), stats.renderUs.avg,
+           stats.renderUs.p99, stats.pushUs.avg, stats.pushUs.p99, fps(stats));
+  }
+}
+
+// ---------------------------
+// scale
+
+static void benchScale() {
+  printf("%-6s %9s %15s %15s %9s %7s %7s\n", "scale", "fb bytes", "pixels written", "pixels pushed", "render us",
+         "push us", "fps");
+  for (uint8_t scale : {1, 2, 4}) {
+    hostMillis = hostMicros = 0;
+    TFT_eSPI tft;
+    TFT_RoboEyes eyes(tft, false, 3);
+    eyes.setRandomSeed(7);
+    eyes.setRenderScale(scale);
+    eyes.begin(50);
+    eyes.setIdleMode(true, 1, 1);
+    eyes.setAutoblinker(true, 1, 1);
+    eyes.setColors(TFT_RED, TFT_BLUE);
+    unsigned long long written = 0, pushed = 0;
+    for (int f = 0; f < 3000; f++) {
+      hostAdvance(20);
+      if (f % 200 == 0) eyes.setMood(f / 200 % 4);
+      if (f == 1500) eyes.setCyclops(true);
+      if (f == 2000) {
+        eyes.setCyclops(false);
+        eyes.setHFlicker(true, 5);
+      }
+      eyes.update();
+      written += eyes.getPixelsWritten();
+      pushed += eyes.getPixelsPushed();
+    }
+    RoboEyesStats stats = eyes.getStats();
+    printf("%-6u %9u %15llu %15llu %9u %7u %7.0f\n", scale, eyes.getFramebufferBytes(), written, pushed,
+           stats.renderUs.avg, stats.pushUs.avg, fps(stats));
+  }
+}
+
+// ---------------------------
+// kernels
+
+struct Kernels : TFT_RoboEyes {
+  using TFT_RoboEyes::fill1;
+  using TFT_RoboEyes::fill16;
+};
+
+// TFT_eSprite::drawFastHLine() as in TFT_eSPI 2.x: one store per pixel,
+// and drawPixel() per pixel at 1 bit
+__attribute__((noinline)) static void spriteLine16(uint16_t *img, int stride, int x, int y, int w, uint16_t color) {
+  color = (color >> 8) | (color << 8);
+  uint32_t at = x + stride * y;
+  while (w--) img[at++] = color;
+}
+__attribute__((noinline)) static void spriteLine8(uint8_t *img, int stride, int x, int y, int w, uint16_t color) {
+  uint8_t c = ((color & 0xE000) >> 8) | ((color & 0x0700) >> 6) | ((color & 0x0018) >> 3);
+  uint32_t at = x + stride * y;
+  while (w--) img[at++] = c;
+}
+__attribute__((noinline)) static void spritePixel1(uint8_t *img, int stride, int x, int y, uint16_t color) {
+  uint8_t bit = 0x80 >> (x & 7);
+  if (color) img[(x + y * stride) >> 3] |= bit;
+  else img[(x + y * stride) >> 3] &= ~bit;
+}
+__attribute__((noinline)) static void spriteLine1(uint8_t *img, int stride, int x, int y, int w, uint16_t color) {
+  while (w--) spritePixel1(img, stride, x++, y, color);
+}
+
+static void benchKernels() {
+  static uint16_t img16[480 * 320];
+  static uint8_t img8[480 * 320];
+  printf("pixels/us, sprite loop -> kernel\n%-5s %19s %19s %19s\n", "span", "16-bit", "8-bit", "1-bit");
+  for (int len : {16, 64, 240}) {
+    const int rows = 320, reps = 20000000 / (len * rows) + 1;
+    auto rate = [&](auto fill) {
+      Clock::time_point start = Clock::now();
+      for (int r = 0; r < reps; r++)
+        for (int y = 0; y < rows; y++) fill(y, r);
+      return (double)reps * rows * len / (nsSince(start) / 1000);
+    };
+    double s16 = rate([&](int y, int r) { spriteLine16(img16, 480, (y * 7) & 15, y, len, 0x1234 + r); });
+    double k16 = rate([&](int y, int r) { Kernels::fill16(img16 + 480 * y + ((y * 7) & 15), len, 0x1234 + r); });
+    double s8 = rate([&](int y, int r) { spriteLine8(img8, 480, (y * 7) & 15, y, len, 0x1234 + r); });
+    double k8 = rate([&](int y, int r) { memset(img8 + 480 * y + ((y * 7) & 15), 0x12 + r, len); });
+    double s1 = rate([&](int y, int r) { spriteLine1(img8, 488, (y * 7) & 15, y, len, r & 1); });
+    double k1 = rate([&](int y, int r) { Kernels::fill1(img8 + 61 * y, (y * 7) & 15, len, (r & 1) ? 0xFF : 0); });
+    printf("%-5d %8.0f -> %7.0f %8.0f -> %7.0f %8.0f -> %7.0f\n", len, s16, k16, s8, k8, s1, k1);
+  }
+}
+
+// ---------------------------
+// cache
+
+// 480x320 with large eyes; flicker keeps every frame moving, so each
+// update() renders
+static void benchCache() {
+  printf("%-6s %9s %5s %7s %7s %7s\n", "cache", "render us", "p99", "fps", "hits", "misses");
+  for (uint32_t bytes : {0, 65536}) {
+    hostMillis = hostMicros = 0;
+    randomSeed(1);
+    TFT_eSPI tft(480, 320);
+    TFT_RoboEyes eyes(tft, false, 1);
+    eyes.setScreenSize(480, 320);
+    eyes.setWidth(160, 160);
+    eyes.setHeight(160, 160);
+    eyes.setBorderradius(40, 40);
+    eyes.setSpacebetween(40);
+    eyes.setExpressionCache(bytes);
+    eyes.begin(50);
+    eyes.setAutoblinker(true, 1, 1);
+    eyes.setIdleMode(true, 1, 1);
+    eyes.setHFlicker(true, 2);
+    for (int f = 0; f < 3000; f++) {
+      hostAdvance(20);
+      if (f % 200 == 0) eyes.setMood(f / 200 % 4);
+      eyes.update();
+    }
+    RoboEyesStats stats = eyes.getStats();
+    printf("%-6s %9u %5u %7.0f %7u %7u\n", bytes ? "64 KB" : "off", stats.renderUs.avg, stats.renderUs.p99,
+           fps(stats), eyes.getCacheHits(), eyes.getCacheMisses());
+  }
+}
+
+// ---------------------------
+// textures
+
+static uint16_t iris[64 * 64];
+static uint16_t highlight[8 * 8];
+
+// Eyes resized every 40 frames, so the texture cache scales new variants
+static void benchTextures() {
+  for (int i = 0; i < 64 * 64; i++) iris[i] = (i * 7919) | 0x0821;
+  for (int i = 0; i < 64; i++) highlight[i] = (i % 3) ? TFT_WHITE : TFT_BLACK;
+  printf("%-9s %9s %5s %7s %5s %7s\n", "eyes", "render us", "p99", "push us", "p99", "fps");
+  for (bool textured : {false, true}) {
+    hostMillis = hostMicros = 0;
+    srand(1);
+    TFT_eSPI tft;
+    TFT_RoboEyes eyes(tft, false, 3);
+    eyes.setRandomSeed(3);
+    eyes.setColorDepth(16);
+    if (textured) {
+      eyes.setEyeTexture(0, iris, 64, 64, 80);
+      eyes.setEyeTexture(2, highlight, 8, 8, 15, 50);
+    }
+    eyes.begin(60);
+    eyes.setHFlicker(true, 1);
+    eyes.setAutoblinker(true, 1, 1);
+    eyes.setIdleMode(true, 1, 1);
+    eyes.setCuriosity(true);
+    for (int f = 0; f < 4000; f++) {
+      hostAdvance(17);
+      if (f % 40 == 0) {
+        int w = 20 + rand() % 50, h = 20 + rand() % 50;
+        eyes.setWidth(w, w);
+        eyes.setHeight(h, h);
+      }
+      if (f % 300 == 0) eyes.setMood(f / 300 % 4);
+      eyes.update();
+    }
+    RoboEyesStats stats = eyes.getStats();
+    printf("%-9s %9u %5u %7u %5u %7.0f\n", textured ? "textured" : "flat", stats.renderUs.avg, stats.renderUs.p99,
+           stats.pushUs.avg, stats.pushUs.p99, fps(stats));
+  }
+}
+
+// ---------------------------
+// gaze
+
+struct GazeSample {
+  unsigned long capture, delivery;  // ms
+  float x, y;
+};
+
+static std::vector<GazeSample> loadTrace(const char *path) {
+  std::vector<GazeSample> trace;
+  FILE *in = fopen(path, "r");
+  if (!in) return trace;
+  char line[128];
+  GazeSample g;
+  while (fgets(line, sizeof(line), in))
+    if (line[0] != '#' && sscanf(line, "%lu %lu %f %f", &g.capture, &g.delivery, &g.x, &g.y) == 4) trace.push_back(g);
+  fclose(in);
+  return trace;
+}
+
+// Where the target was at ms, between the captured samples
+static void traceAt(const std::vector<GazeSample> &trace, double ms, double &x, double &y) {
+  size_t i = 1;
+  while (i < trace.size() - 1 && trace[i].capture < ms) i++;
+  const GazeSample &a = trace[i - 1], &b = trace[i];
+  double t = (ms - a.capture) / (double)(b.capture - a.capture);
+  t = t < 0 ? 0 : (t > 1 ? 1 : t);
+  x = a.x + (b.x - a.x) * t;
+  y = a.y + (b.y - a.y) * t;
+}
+
+// Each sample is handed to setGaze() at its delivery time, the eyes
+// update every simulated millisecond. Input-to-pixels is the lag at which
+// the eye position on the panel best matches the target's path (capture
+// to pixels, so it includes the tracker's delay); the error is measured
+// at that lag and at none.
+static void benchGaze() {
+  std::vector<GazeSample> trace = loadTrace("gaze_trace.txt");
+  if (trace.size() < 2) {
+    printf("cannot read gaze_trace.txt\n");
+    return;
+  }
+  double delay = 0;
+  for (const GazeSample &g : trace) delay += g.delivery - g.capture;
+  printf("%zu samples over %lu ms, tracker delay %.0f ms\n", trace.size(), trace.back().capture,
+         delay / trace.size());
+  printf("%-8s %12s %17s %12s %14s\n", "lead ms", "latency ms", "input-to-pixels", "error px", "error px lag 0");
+  const unsigned long end = trace.back().capture;
+  for (uint16_t lead : {0, 40, 80}) {
+    hostMillis = hostMicros = 0;
+    TFT_eSPI tft;
+    TFT_RoboEyes eyes(tft, false, 3);
+    eyes.setRandomSeed(1);
+    eyes.begin(50);
+    eyes.setIdleMode(true, 1, 1);
+    eyes.setGazePrediction(lead);
+    std::vector<double> shownX(end), shownY(end);
+    double latency = 0;
+    unsigned latencies = 0;
+    bool delivered = false;
+    size_t next = 0;
+    for (unsigned long ms = 0; ms < end; ms++) {
+      hostMillis = ms;
+      hostMicros = ms * 1000UL;
+      for (; next < trace.size() && trace[next].delivery <= ms; next++) {
+        eyes.setGaze(trace[next].x, trace[next].y);
+        delivered = true;
+      }
+      eyes.update();
+      if (delivered && ms % 20 == 0) {  // a frame was due
+        latency += eyes.getGazeLatency();
+        latencies++;
+        delivered = false;
+      }
+      shownX[ms] = eyes.eye.x[0];
+      shownY[ms] = eyes.eye.y[0];
+    }
+
+    // Mean error in px when the panel is compared with the target lag ms ago
+    const double w = eyes.getScreenConstraint_X(), h = eyes.getScreenConstraint_Y();
+    auto error = [&](int lag) {
+      double sum = 0;
+      unsigned n = 0;
+      for (unsigned long ms = 1000; ms < end; ms += 5) {
+        double x, y;
+        traceAt(trace, (double)ms - lag, x, y);
+        sum += hypot(shownX[ms] - x * w, shownY[ms] - y * h);
+        n++;
+      }
+      return sum / n;
+    };
+    int best = 0;
+    for (int lag = 1; lag <= 250; lag++)
+      if (error(lag) < error(best)) best = lag;
+    printf("%-8u %12.1f %14d ms %12.2f %14.2f\n", lead, latencies ? latency / latencies : 0.0, best, error(best),
+           error(0));
+  }
+}
+
+int main(int argc, char **argv) {
+  struct Section {
+    const char *name;
+    void (*run)();
+  };
+  static const Section sections[] = {
+      {"moods", benchMoods}, {"depths", benchDepths}, {"scale", benchScale}, {"kernels", benchKernels},
+      {"cache", benchCache}, {"textures", benchTextures}, {"gaze", benchGaze},
+  };
+  for (const Section &s : sections) {
+    bool wanted = argc < 2;
+    for (int i = 1; i < argc; i++) wanted |= std::string(argv[i]) == s.name;
+    if (!wanted) continue;
+    printf("== %s\n", s.name);
+    s.run();
+    printf("\n");
+  }
+  return 0;
+}
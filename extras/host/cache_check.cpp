@@ -0,0 +1,155 @@
+// Expression cache: each scenario runs without the cache, with a cache
+// big enough for all its frames and with a 512-byte one, in full-frame, band
+// and DMA mode. After every frame the panel must match the uncached
+// run's. The big cache must replay frames. The small one must stay within
+// its budget, and evict frames whenever the big one holds more than that.
+//
+// Two eye shapes whose keys differ but share a digest must not replay
+// each other's frame.
+//
+// Exit status 0 when everything checks out.
+
+#include <functional>
+#include <map>
+#include <vector>
+#include "RoboEyesTFT_eSPI.h"
+
+struct Scenario {
+  const char *name;
+  std::function<void(TFT_RoboEyes &, int)> frame;  // before update() of frame f
+};
+
+static const Scenario scenarios[] = {
+  {"blinks", [](TFT_RoboEyes &e, int f) { if (f == 0) e.setAutoblinker(true, 1, 1); }},
+  {"moods", [](TFT_RoboEyes &e, int f) {
+     if (f == 0) e.setAutoblinker(true, 1, 1);
+     if (f % 50 == 0) e.setMood(f / 50 % 4);
+   }},
+  {"idle", [](TFT_RoboEyes &e, int f) { if (f == 0) e.setIdleMode(true, 1, 1); }},
+  {"cyclops", [](TFT_RoboEyes &e, int f) {
+     if (f == 0) e.setCyclops(true);
+     if (f % 40 == 0) e.blink();
+   }},
+  {"laugh", [](TFT_RoboEyes &e, int f) { if (f % 80 == 0) e.anim_laugh(); }},
+};
+
+struct Mode {
+  const char *name;
+  std::function<void(TFT_RoboEyes &)> setup;  // before begin()
+};
+
+static const Mode modes[] = {
+  {"full", [](TFT_RoboEyes &) {}},
+  {"bands", [](TFT_RoboEyes &e) { e.setBandRendering(4); }},
+  {"dma", [](TFT_RoboEyes &e) { e.setDoubleBuffered(true); }},
+};
+
+struct Run {
+  TFT_eSPI tft;
+  TFT_RoboEyes eyes;
+  Run(const Mode &mode, uint32_t cache) : eyes(tft, false, 3) {
+    mode.setup(eyes);
+    eyes.setExpressionCache(cache);
+    eyes.begin(50);
+  }
+};
+
+// Sets the eye shapes directly and looks their frame up in the cache
+class Probe : public TFT_RoboEyes {
+  public:
+    using TFT_RoboEyes::EyeShape;
+    Probe(TFT_eSPI &tft) : TFT_RoboEyes(tft, false, 3) {}
+
+    void setShapes(const EyeShape *shapes) {  // two eyes
+      eye.shape[0] = shapes[0];
+      eye.shape[1] = shapes[1];
+    }
+    std::vector<int32_t> key(uint32_t &digest) {
+      Surface &sf = surfaces[0];
+      Rect box = unionRect(Rect{eye.shape[0].x, eye.shape[0].y, eye.shape[0].w, eye.shape[0].h},
+                           Rect{eye.shape[1].x, eye.shape[1].y, eye.shape[1].w, eye.shape[1].h});
+      int32_t words[CACHE_KEY_WORDS];
+      return std::vector<int32_t>(words, words + cacheKey(sf, box, words, digest));
+    }
+    void lookUp() { cachedFrame<RoboEyesSpec<ROBOEYES_FEATURE_ALL> >(surfaces[0]); }
+};
+
+// Draws random eye pairs until two different keys share a digest, then
+// looks both up: the second one must miss
+static bool collisionCheck() {
+  TFT_eSPI tft;
+  Probe probe(tft);
+  probe.setExpressionCache(65536);
+  probe.begin(50);
+  std::map<uint32_t, std::pair<std::vector<int32_t>, int> > seen;
+  std::vector<Probe::EyeShape> shapes(2 * 400000);
+  randomSeed(7);
+  for (size_t i = 0; i < shapes.size() / 2; i++) {
+    for (int k = 0; k < 2; k++) {
+      Probe::EyeShape &e = shapes[2 * i + k];
+      memset(&e, 0, sizeof(e));
+      e.x = 10 + 120 * k + random(60);
+      e.y = 10 + random(40);
+      e.w = 20 + random(40);
+      e.h = 20 + random(60);
+      e.r = random(10);
+    }
+    probe.setShapes(&shapes[2 * i]);
+    uint32_t digest;
+    std::vector<int32_t> key = probe.key(digest);
+    auto found = seen.find(digest);
+    if (found == seen.end()) {
+      seen[digest] = {key, (int)i};
+      continue;
+    }
+    if (found->second.first == key) continue;
+    probe.setShapes(&shapes[2 * found->second.second]);
+    probe.lookUp();
+    probe.setShapes(&shapes[2 * i]);
+    probe.lookUp();
+    bool missed = probe.getCacheMisses() == 2 && probe.getCacheHits() == 0;
+    probe.setShapes(&shapes[2 * found->second.second]);
+    probe.lookUp();
+    bool good = missed && probe.getCacheHits() == 1;
+    printf("collision after %zu shapes, digest %08x: second key %s, first key %s%s\n", i + 1, digest,
+           missed ? "missed" : "HIT", probe.getCacheHits() == 1 ? "hit again" : "did not hit", good ? "" : "  FAILED");
+    return good;
+  }
+  printf("no digest collision in %zu shapes  FAILED\n", shapes.size() / 2);
+  return false;
+}
+
+int main() {
+  bool ok = true;
+  uint32_t evictions = 0;
+  for (const Scenario &sc : scenarios)
+    for (const Mode &mode : modes) {
+      Run plain(mode, 0), big(mode, 200000), small(mode, 512);
+      int differing = 0;
+      uint32_t peak = 0, bigPeak = 0;
+      for (int f = 0; f < 400; f++) {
+        hostMillis = 20 * (f + 1);
+        hostMicros = hostMillis * 1000;
+        for (Run *run : {&plain, &big, &small}) {
+          randomSeed(f);
+          sc.frame(run->eyes, f);
+          run->eyes.update();
+        }
+        differing += big.tft.shown() != plain.tft.shown();
+        differing += small.tft.shown() != plain.tft.shown();
+        peak = max(peak, small.eyes.getCacheBytes());
+        bigPeak = max(bigPeak, big.eyes.getCacheBytes());
+      }
+      bool good = differing == 0 && big.eyes.getCacheHits() > 0 && peak <= 512
+                  && (bigPeak <= 512 || small.eyes.getCacheEvictions() > 0);
+      printf("%-8s %-6s %5u bytes, %4u hits | 512 B: %4u hits, %3u evicted, peak %4u | %d frames differ%s\n", sc.name,
+             mode.name, bigPeak, big.eyes.getCacheHits(), small.eyes.getCacheHits(), small.eyes.getCacheEvictions(),
+             peak, differing, good ? "" : "  FAILED");
+      ok &= good;
+      evictions += small.eyes.getCacheEvictions();
+    }
+  ok &= evictions > 0;
+  ok &= collisionCheck();
+  printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
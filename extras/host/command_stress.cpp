@@ -0,0 +1,104 @@
+// Render task command queue under load: a producer thread posts 10k
+// setter calls per second while the render task draws at 50 fps on the
+// wall clock. Every command taken off the queue must be the next one
+// posted, whole and in order. Repeated state setters must post nothing,
+// and stopRenderTask() must apply what is still queued before returning.
+// The render task is started and stopped several times.
+//
+// Exit status 0 when everything checks out.
+
+#define ROBOEYES_TASK 1
+#include "freertos_host.h"
+
+struct Traced {
+  uint8_t op, a, b;
+  uint16_t c, d;
+};
+static void traceCommand(const Traced &cmd);
+#define ROBOEYES_COMMAND_TRACE(cmd) traceCommand(Traced{(cmd).op, (cmd).a, (cmd).b, (cmd).c, (cmd).d})
+
+#include "RoboEyesTFT_eSPI.h"
+
+using Clock = std::chrono::steady_clock;
+
+static unsigned long wallClock() {
+  static const Clock::time_point start = Clock::now();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+}
+
+// Command k of a run: width, space and gaze changes in turn. Consecutive
+// calls of one setter always differ, so none of them is a repeat.
+static Traced expected(uint32_t k) {
+  uint32_t j = k / 3;
+  switch (k % 3) {
+    case 0: return Traced{TFT_RoboEyes::CMD_WIDTH, (uint8_t)(20 + j % 50), (uint8_t)(20 + (j * 7) % 50), 0, 0};
+    case 1: return Traced{TFT_RoboEyes::CMD_SPACE, 0, 0, (uint16_t)(j % 40), 0};
+    default: return Traced{TFT_RoboEyes::CMD_POSITION, (uint8_t)(1 + j % 8), 0, 0, 0};
+  }
+}
+
+static void post(TFT_RoboEyes &eyes, const Traced &cmd) {
+  switch (cmd.op) {
+    case TFT_RoboEyes::CMD_WIDTH: eyes.setWidth(cmd.a, cmd.b); break;
+    case TFT_RoboEyes::CMD_SPACE: eyes.setSpacebetween(cmd.c); break;
+    default: eyes.setPosition(cmd.a); break;
+  }
+}
+
+static std::atomic<uint32_t> traced(0), torn(0), moods(0);
+
+// Runs on the render task only
+static void traceCommand(const Traced &cmd) {
+  if (cmd.op == TFT_RoboEyes::CMD_MOOD) {
+    moods++;
+    return;
+  }
+  Traced want = expected(traced++);
+  if (cmd.op != want.op || cmd.a != want.a || cmd.b != want.b || cmd.c != want.c || cmd.d != want.d) torn++;
+}
+
+int main() {
+  const uint32_t rate = 10000, seconds = 1, rounds = 3;
+  TFT_eSPI tft;
+  TFT_RoboEyes eyes(tft, false, 3);
+  eyes.setClock(wallClock);
+  eyes.begin(50);
+  eyes.setAutoblinker(true, 1, 1);
+
+  bool ok = true;
+  uint32_t posted = 0;
+  for (uint32_t round = 0; round < rounds; round++) {
+    if (!eyes.startRenderTask()) {
+      printf("round %u: render task did not start\n", round);
+      return 1;
+    }
+    uint32_t moodsBefore = moods;
+    std::thread producer([&] {
+      Clock::time_point start = Clock::now();
+      for (uint32_t i = 0; i < rate * seconds; i++) {
+        post(eyes, expected(posted++));
+        if (i % 1000 == 0) {
+          for (int r = 0; r < 100; r++) eyes.setMood(i % 2000 ? HAPPY : ANGRY);
+        }
+        if (i % 10 == 9) std::this_thread::sleep_until(start + std::chrono::microseconds((i + 1) * 1000000ULL / rate));
+      }
+    });
+    producer.join();
+    eyes.stopRenderTask();
+
+    // Setters apply directly again once the task is gone
+    uint32_t before = traced;
+    eyes.setWidth(33, 34);
+    bool direct = traced == before && eyes.eye.widthDefault[0] == 33;
+    Traced last = expected(posted - 3);
+    eyes.setWidth(last.a, last.b);
+
+    printf("round %u: posted %u, taken %u, torn %u, mood commands %u of %u calls, direct after stop %s\n",
+           round, posted, (uint32_t)traced, (uint32_t)torn, (uint32_t)moods - moodsBefore,
+           rate * seconds / 1000 * 100, direct ? "yes" : "NO");
+    ok &= traced == posted && torn == 0 && direct;
+    ok &= moods - moodsBefore == rate * seconds / 1000;  // one per change of mood
+  }
+  printf("dropped %u\n%s\n", eyes.getDroppedCommands(), ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
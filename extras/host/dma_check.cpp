@@ -0,0 +1,55 @@
+// DMA double buffering against the stand-in's asynchronous transfers:
+// each scenario runs twice from the same random seed, once pushing dirty
+// rects and once by DMA. After every frame the panel, with the transfer
+// still in flight counted as landed, must match the dirty-rect run, and
+// no buffer may be drawn into while a transfer is reading it.
+//
+// Exit status 0 when everything checks out.
+
+#include <functional>
+#include "RoboEyesTFT_eSPI.h"
+
+struct Scenario {
+  const char *name;
+  std::function<void(TFT_RoboEyes &, int)> frame;  // before update() of frame f
+};
+
+static const Scenario scenarios[] = {
+  {"moods", [](TFT_RoboEyes &e, int f) { if (f % 40 == 0) e.setMood(f / 40 % 4); }},
+  {"positions", [](TFT_RoboEyes &e, int f) { if (f % 25 == 0) e.setPosition(f / 25 % 9); }},
+  {"blinks", [](TFT_RoboEyes &e, int f) { if (f == 0) e.setAutoblinker(true, 1, 1); }},
+  {"idle", [](TFT_RoboEyes &e, int f) { if (f == 0) e.setIdleMode(true, 1, 1); }},
+  {"cyclops", [](TFT_RoboEyes &e, int f) { if (f == 0) e.setCyclops(true); if (f == 90) e.setCyclops(false); }},
+  {"flicker", [](TFT_RoboEyes &e, int f) { if (f == 0) e.setHFlicker(true, 2); if (f == 60) e.setVFlicker(true, 10); }},
+  {"laugh", [](TFT_RoboEyes &e, int f) { if (f % 60 == 0) e.anim_laugh(); }},
+  {"confused", [](TFT_RoboEyes &e, int f) { if (f % 60 == 0) e.anim_confused(); }},
+};
+
+int main() {
+  bool ok = true;
+  for (const Scenario &sc : scenarios) {
+    TFT_eSPI plainTft, dmaTft;
+    TFT_RoboEyes plain(plainTft, false, 3), dma(dmaTft, false, 3);
+    dma.setDoubleBuffered(true);
+    plain.begin(50);
+    dma.begin(50);
+    int differing = 0;
+    for (int f = 0; f < 200; f++) {
+      hostMillis = 20 * (f + 1);
+      hostMicros = hostMillis * 1000;
+      randomSeed(f);
+      sc.frame(plain, f);
+      plain.update();
+      randomSeed(f);
+      sc.frame(dma, f);
+      dma.update();
+      if (dmaTft.shown() != plainTft.fb) differing++;
+    }
+    bool good = differing == 0 && dmaTft.dmaOverwrites == 0 && dmaTft.dmaTransfers > 0;
+    printf("%-10s %4lu transfers, %lu overwritten in flight, %d frames differ%s\n", sc.name, dmaTft.dmaTransfers,
+           dmaTft.dmaOverwrites, differing, good ? "" : "  FAILED");
+    ok &= good;
+  }
+  printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
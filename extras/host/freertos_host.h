@@ -0,0 +1,129 @@
+/*
+ * Host stand-in for the FreeRTOS calls behind ROBOEYES_TASK: tasks are
+ * std::threads, task notifications and binary semaphores are a counter or
+ * flag under a mutex. Pinning and priorities are ignored. Include it
+ * before RoboEyesTFT_eSPI.h and build with -DROBOEYES_TASK=1.
+ */
+
+#ifndef _ROBOEYES_HOST_FREERTOS_H
+#define _ROBOEYES_HOST_FREERTOS_H
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdPASS 1
+#define pdFAIL 0
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY 0xFFFFFFFFu
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portYIELD_FROM_ISR() \
+  do {                       \
+  } while (0)
+
+struct HostTask {
+  std::mutex lock;
+  std::condition_variable wake;
+  uint32_t notifications = 0;
+};
+typedef HostTask *TaskHandle_t;
+
+// Thrown by vTaskDelete(nullptr) to end the calling task's thread
+struct HostTaskExit {};
+
+inline thread_local HostTask *hostCurrentTask = nullptr;
+inline thread_local std::unique_ptr<HostTask> hostThreadTask;
+
+// The calling thread's task. Threads not started as tasks (main(), like
+// loop()'s task on the device) get one on first use.
+inline HostTask *hostSelf() {
+  if (!hostCurrentTask) {
+    hostThreadTask.reset(new HostTask);
+    hostCurrentTask = hostThreadTask.get();
+  }
+  return hostCurrentTask;
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(void (*fn)(void *), const char *, uint32_t, void *arg,
+                                          UBaseType_t, TaskHandle_t *handle, BaseType_t) {
+  HostTask *task = new HostTask;
+  if (handle) *handle = task;
+  std::thread([=] {
+    hostCurrentTask = task;
+    try {
+      fn(arg);
+    } catch (HostTaskExit &) {
+    }
+    delete task;
+  }).detach();
+  return pdPASS;
+}
+
+// Only a task deleting itself is supported, as RoboEyes does
+inline void vTaskDelete(TaskHandle_t task) {
+  if (!task || task == hostCurrentTask) throw HostTaskExit();
+  abort();
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return hostSelf(); }
+inline bool xPortInIsrContext() { return false; }
+inline void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+  HostTask *task = hostSelf();
+  std::unique_lock<std::mutex> lock(task->lock);
+  auto ready = [&] { return task->notifications > 0; };
+  if (ticks == portMAX_DELAY) task->wake.wait(lock, ready);
+  else task->wake.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+  uint32_t count = task->notifications;
+  if (count) task->notifications = clear ? 0 : count - 1;
+  return count;
+}
+// Signalled under the lock: the waiter may delete the task (or semaphore)
+// as soon as it sees the notification
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  std::lock_guard<std::mutex> lock(task->lock);
+  task->notifications++;
+  task->wake.notify_one();
+  return pdPASS;
+}
+inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) {
+  xTaskNotifyGive(task);
+  if (woken) *woken = pdFALSE;
+}
+
+struct HostSemaphore {
+  std::mutex lock;
+  std::condition_variable wake;
+  bool given = false;
+};
+typedef HostSemaphore *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateBinary() { return new HostSemaphore; }
+inline void vSemaphoreDelete(SemaphoreHandle_t sem) { delete sem; }
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+  std::lock_guard<std::mutex> lock(sem->lock);
+  sem->given = true;
+  sem->wake.notify_one();
+  return pdTRUE;
+}
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+  std::unique_lock<std::mutex> lock(sem->lock);
+  auto ready = [&] { return sem->given; };
+  if (ticks == portMAX_DELAY) sem->wake.wait(lock, ready);
+  else if (!sem->wake.wait_for(lock, std::chrono::milliseconds(ticks), ready)) return pdFALSE;
+  sem->given = false;
+  return pdTRUE;
+}
+
+#endif
@@ -0,0 +1,296 @@
+// Golden-frame checks: every mood, every position, cyclops and each
+// animation runs for 3 simulated seconds on a 240x135 panel with a fixed
+// clock and random seed. Per scenario the checksums of all frames are
+// folded into one value and compared with golden.txt.
+//
+// Each scenario is drawn in several buffer modes (1, 8 and 16-bit
+// buffers, bands, DMA double buffering, the expression cache), which must
+// all give the golden value. Modes that change the picture (render scale)
+// have golden values of their own, "scenario/key" in golden.txt. Every
+// run ends with end() and a fresh begin(); in the storage modes the frame
+// buffers and cache live in static arrays, which end() must not free or
+// write past. After every frame getFrameChecksum() must
+// also match the pixels on the panel, and DMA mode must never draw into a
+// buffer that is still being sent.
+//
+// Usage: golden [golden.txt]          check, exit status 0 when all match
+//        golden --update [golden.txt] rewrite the file from this build
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "RoboEyesTFT_eSPI.h"
+
+static unsigned long hostClock() { return hostMillis; }
+
+struct Scenario {
+  const char *name;
+  std::function<void(TFT_RoboEyes &)> setup;  // after begin()
+  std::function<void(TFT_RoboEyes &, int)> frame;  // before update() of frame f
+  bool rgb332 = true;  // only colors an 8-bit buffer shows unchanged
+};
+
+struct Mode {
+  const char *name;
+  std::function<void(TFT_RoboEyes &)> setup;  // before begin()
+  const char *key = nullptr;  // golden value of its own
+  bool rgb332 = false;  // the panel only matches for colors RGB332 keeps
+  void (*frame)(TFT_RoboEyes &, int) = nullptr;  // before update() of frame f
+};
+
+// Caller storage for the storage modes, each followed by guard bytes
+static const uint32_t frameBytes = 131072, cacheBytes = 65536, guardBytes = 64;
+static uint8_t frameStorage[frameBytes + guardBytes], cacheStorage[cacheBytes + guardBytes];
+
+static bool guardsIntact() {
+  for (uint32_t i = 0; i < guardBytes; i++) {
+    if (frameStorage[frameBytes + i] != 0xA5 || cacheStorage[cacheBytes + i] != 0xA5) return false;
+  }
+  return true;
+}
+
+// Layers: a gradient background image and a HUD overlay whose color
+// changes, and is invalidated, every 25 frames
+static uint16_t backgroundImage[240 * 135];
+static int hudValue;
+
+static void drawHud(TFT_eSprite &sprite, void *) {
+  sprite.fillRect(8, 8, 60, 14, TFT_BLACK);
+  sprite.fillRect(10, 10, 56, 10, hudValue % 2 ? TFT_GREEN : TFT_RED);
+}
+
+static void drawStripes(TFT_eSprite &sprite, void *) {
+  for (int y = 0; y < 135; y += 8) sprite.fillRect(0, y, 240, 4, 0x2104);
+}
+
+static void setupLayers(TFT_RoboEyes &e) {
+  hudValue = 0;
+  e.setBackground(0, backgroundImage);
+  e.addOverlay(0, 8, 8, 60, 14, drawHud);
+}
+
+static void hudFrame(TFT_RoboEyes &e, int f) {
+  if (f % 25 == 0) {
+    hudValue++;
+    e.invalidateOverlay(0);
+  }
+}
+
+// Textures: an RGB565 iris, an indexed pupil and a highlight, black
+// (index 0) transparent
+static uint16_t irisImage[48 * 48], highlightImage[8 * 8];
+static uint8_t pupilImage[16 * 16];
+static const uint16_t pupilPalette[] = {TFT_BLACK, 0x18C3, 0x4208};
+
+static void setupTextures(TFT_RoboEyes &e) {
+  e.setEyeTexture(0, irisImage, 48, 48, 80);
+  e.setEyeTexture(1, pupilImage, pupilPalette, 16, 16, 35);
+  e.setEyeTexture(2, highlightImage, 8, 8, 15, 50);
+}
+
+static const Mode modes[] = {
+  {"1-bit", [](TFT_RoboEyes &e) { e.setColorDepth(1); }},
+  {"8-bit", [](TFT_RoboEyes &e) { e.setColorDepth(8); }, nullptr, true},
+  {"16-bit", [](TFT_RoboEyes &e) { e.setColorDepth(16); }},
+  {"bands", [](TFT_RoboEyes &e) { e.setBandRendering(4); }},
+  {"dma", [](TFT_RoboEyes &e) { e.setDoubleBuffered(true); }},
+  {"cache", [](TFT_RoboEyes &e) { e.setExpressionCache(65536); }},
+  {"storage", [](TFT_RoboEyes &e) {
+     e.setFrameBuffer(frameStorage, frameBytes);
+     e.setExpressionCache(cacheBytes, cacheStorage);
+   }},
+  {"stor-dma", [](TFT_RoboEyes &e) {
+     e.setDoubleBuffered(true);
+     e.setFrameBuffer(frameStorage, frameBytes);
+   }},
+  {"layers", setupLayers, "layers", false, hudFrame},
+  {"lay-dma", [](TFT_RoboEyes &e) {
+     e.setDoubleBuffered(true);
+     setupLayers(e);
+   }, "layers", false, hudFrame},
+  {"lay-cache", [](TFT_RoboEyes &e) {
+     e.setExpressionCache(65536);
+     setupLayers(e);
+   }, "layers", false, hudFrame},
+  {"bg-draw", [](TFT_RoboEyes &e) {
+     e.setBackground(0, drawStripes);
+     e.setDoubleBuffered(true);
+   }, "bg-draw"},
+  {"texture", setupTextures, "texture"},
+  {"tex-dma", [](TFT_RoboEyes &e) {
+     e.setDoubleBuffered(true);
+     setupTextures(e);
+   }, "texture"},
+  {"tex-cache", [](TFT_RoboEyes &e) {
+     e.setExpressionCache(65536);
+     setupTextures(e);
+   }, "texture"},
+  {"scale2", [](TFT_RoboEyes &e) { e.setRenderScale(2); }, "scale2"},
+  {"scale2b", [](TFT_RoboEyes &e) {
+     e.setRenderScale(2);
+     e.setBandRendering(4);
+   }, "scale2"},
+  {"scale4", [](TFT_RoboEyes &e) { e.setRenderScale(4); }, "scale4"},
+};
+
+static void none(TFT_RoboEyes &, int) {}
+
+static std::vector<Scenario> scenarios() {
+  std::vector<Scenario> list;
+  static const char *moods[] = {"default", "tired", "angry", "happy"};
+  for (int mood = DEFAULT; mood <= HAPPY; mood++) {
+    list.push_back({moods[mood], [=](TFT_RoboEyes &e) { e.setMood(mood); }, none});
+  }
+  static const char *positions[] = {"center", "N", "NE", "E", "SE", "S", "SW", "W", "NW"};
+  for (int p = DEFAULT; p <= NW; p++) {
+    list.push_back({positions[p], [=](TFT_RoboEyes &e) { e.setPosition(p); }, none});
+  }
+  list.push_back({"cyclops", [](TFT_RoboEyes &e) { e.setCyclops(true); }, none});
+  list.push_back({"cyclops-angry-W", [](TFT_RoboEyes &e) {
+                    e.setCyclops(true);
+                    e.setMood(ANGRY);
+                    e.setPosition(W);
+                  }, none});
+  list.push_back({"curious-E", [](TFT_RoboEyes &e) {
+                    e.setCuriosity(true);
+                    e.setPosition(E);
+                  }, none});
+  list.push_back({"blink", [](TFT_RoboEyes &) {}, [](TFT_RoboEyes &e, int f) {
+                    if (f == 40) e.blink();
+                    if (f == 90) e.blink(true, false);
+                  }});
+  list.push_back({"close-open", [](TFT_RoboEyes &) {}, [](TFT_RoboEyes &e, int f) {
+                    if (f == 30) e.close();
+                    if (f == 80) e.open();
+                  }});
+  list.push_back({"autoblinker", [](TFT_RoboEyes &e) { e.setAutoblinker(true, 1, 1); }, none});
+  list.push_back({"idle", [](TFT_RoboEyes &e) { e.setIdleMode(true, 1, 1); }, none});
+  list.push_back({"laugh", [](TFT_RoboEyes &e) { e.anim_laugh(); }, none});
+  list.push_back({"confused", [](TFT_RoboEyes &e) { e.anim_confused(); }, none});
+  list.push_back({"hflicker", [](TFT_RoboEyes &e) { e.setHFlicker(true, 2); }, none});
+  list.push_back({"vflicker", [](TFT_RoboEyes &e) { e.setVFlicker(true, 10); }, none});
+  list.push_back({"mood-changes", [](TFT_RoboEyes &e) { e.setIdleMode(true, 1, 1); }, [](TFT_RoboEyes &e, int f) {
+                    if (f % 30 == 0) e.setMood(f / 30 % 4);
+                  }});
+  list.push_back({"fade", [](TFT_RoboEyes &e) { e.setAutoblinker(true, 1, 1); }, [](TFT_RoboEyes &e, int f) {
+                    if (f >= 10 && f < 60) e.fadeColors(TFT_RED, TFT_BLUE, 500);  // repeats cost nothing
+                    if (f == 80) e.fadeColors(TFT_YELLOW, TFT_BLACK, 1000);
+                    if (f == 100) e.fadeColors(TFT_CYAN, TFT_RED, 300);  // mid-fade
+                    if (f == 140) e.setColors(TFT_WHITE, TFT_BLACK);
+                  }, false});
+  return list;
+}
+
+// FNV-1a over the panel, byte for byte like getFrameChecksum(), with a
+// DMA transfer still in flight counted as done
+static uint32_t panelChecksum(const TFT_eSPI &tft) {
+  uint32_t h = 2166136261UL;
+  for (uint16_t color : tft.shown()) {
+    h = (h ^ (color >> 8)) * 16777619UL;
+    h = (h ^ (color & 0xFF)) * 16777619UL;
+  }
+  return h;
+}
+
+// Fold of every frame's checksum; returns what went wrong, if anything
+static const char *run(const Scenario &sc, const Mode &mode, uint32_t &result) {
+  hostMillis = hostMicros = 0;
+  TFT_eSPI tft;
+  TFT_RoboEyes eyes(tft, false, 3);
+  eyes.setClock(hostClock);
+  eyes.setRandomSeed(1);
+  mode.setup(eyes);
+  if (!eyes.begin(50)) return "begin() failed";
+  sc.setup(eyes);
+  result = 2166136261UL;
+  bool panel = true;
+  for (int f = 0; f < 150; f++) {
+    sc.frame(eyes, f);
+    if (mode.frame) mode.frame(eyes, f);
+    hostAdvance(20);
+    eyes.update();
+    uint32_t sum = eyes.getFrameChecksum();
+    panel &= sum == panelChecksum(tft) || (mode.rgb332 && !sc.rgb332);
+    result = (result ^ sum) * 16777619UL;
+  }
+  if (!panel) return "checksum differs from the panel";
+  if (tft.dmaOverwrites) return "DMA source overwritten in flight";
+
+  // Free static storage and glibc aborts
+  eyes.end();
+  if (!guardsIntact()) return "wrote past caller storage";
+  if (!eyes.begin(50)) return "begin() failed after end()";
+  hostAdvance(20);
+  eyes.update();
+  if (eyes.getFrameChecksum() != panelChecksum(tft) && !(mode.rgb332 && !sc.rgb332)) {
+    return "checksum differs from the panel after end()";
+  }
+  return nullptr;
+}
+
+int main(int argc, char **argv) {
+  bool update = argc > 1 && strcmp(argv[1], "--update") == 0;
+  const char *path = argc > 1 + update ? argv[1 + update] : "golden.txt";
+
+  std::map<std::string, uint32_t> golden;
+  if (!update) {
+    FILE *in = fopen(path, "r");
+    if (!in) {
+      printf("cannot read %s\n", path);
+      return 1;
+    }
+    char name[64];
+    unsigned value;
+    while (fscanf(in, "%63s %x", name, &value) == 2) golden[name] = value;
+    fclose(in);
+  }
+
+  FILE *out = update ? fopen(path, "w") : nullptr;
+  if (update && !out) {
+    printf("cannot write %s\n", path);
+    return 1;
+  }
+  for (int i = 0; i < 240 * 135; i++) {
+    int x = i % 240, y = i / 240;
+    backgroundImage[i] = (x / 8) << 11 | (y / 3) << 5 | 8;
+  }
+  for (int i = 0; i < 48 * 48; i++) {
+    int x = i % 48 - 24, y = i / 48 - 24;
+    irisImage[i] = x * x + y * y > 24 * 24 ? TFT_BLACK : (uint16_t)((x + y) * 97 | 0x0841);
+  }
+  for (int i = 0; i < 16 * 16; i++) {
+    int x = i % 16 - 8, y = i / 16 - 8;
+    pupilImage[i] = x * x + y * y > 64 ? 0 : 1 + (x * x + y * y < 16);
+  }
+  for (int i = 0; i < 8 * 8; i++) highlightImage[i] = (i % 3) ? TFT_WHITE : TFT_BLACK;
+  memset(frameStorage + frameBytes, 0xA5, guardBytes);
+  memset(cacheStorage + cacheBytes, 0xA5, guardBytes);
+  unsigned failed = 0, count = 0;
+  for (const Scenario &sc : scenarios()) {
+    std::map<std::string, uint32_t> first;  // by golden key, in file order
+    std::vector<std::string> keys;
+    for (const Mode &mode : modes) {
+      std::string key = mode.key ? std::string(sc.name) + "/" + mode.key : sc.name;
+      uint32_t value;
+      const char *problem = run(sc, mode, value);
+      if (!first.count(key)) {
+        first[key] = value;
+        keys.push_back(key);
+      }
+      if (!problem && value != first[key]) problem = mode.key ? "differs from its first mode" : "differs from 1-bit";
+      if (!problem && !update && (!golden.count(key) || golden[key] != value)) problem = "differs from golden";
+      if (problem) {
+        printf("%-16s %-7s %08x  %s\n", sc.name, mode.name, value, problem);
+        failed++;
+      }
+      count++;
+    }
+    if (out)
+      for (const std::string &key : keys) fprintf(out, "%s %08x\n", key.c_str(), first[key]);
+  }
+  if (out) fclose(out);
+  printf("%u of %u runs match%s\n%s\n", count - failed, count, update ? " (golden file rewritten)" : "",
+         failed ? "FAILED" : "OK");
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,92 @@
+// Headless driver: runs the eyes on a simulated clock, one frame interval
+// per update(), as fast as the host allows, and writes the frames out.
+//
+// Usage: headless [options]
+//   -t seconds    simulated time (default 600)
+//   -f fps        frame rate (default 50)
+//   -s seed       random seed (default 1)
+//   -m mood       0 default, 1 tired, 2 angry, 3 happy
+//   -c            cyclops
+//   -p prefix     write every n-th frame as prefix_NNNNNN.ppm
+//   -n n          frame step for -p (default 50)
+//   -r            write every frame to stdout as raw RGB565 (the panel,
+//                 row major, little endian)
+//
+// Autoblinker and idle mode are on. Prints the frame count, the wall time
+// taken and the checksum of the last frame to stderr.
+
+#include <chrono>
+#include "RoboEyesTFT_eSPI.h"
+
+static unsigned long hostClock() { return hostMillis; }
+
+class FilePrint : public Print {
+  public:
+    explicit FilePrint(FILE *f) : file(f) {}
+    size_t write(uint8_t c) { return fputc(c, file) == EOF ? 0 : 1; }
+    size_t write(const uint8_t *buffer, size_t size) { return fwrite(buffer, 1, size, file); }
+
+  private:
+    FILE *file;
+};
+
+int main(int argc, char **argv) {
+  unsigned long seconds = 600;
+  int fps = 50, mood = DEFAULT, every = 50;
+  uint32_t seed = 1;
+  bool cyclops = false, raw = false;
+  const char *prefix = nullptr;
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!strcmp(arg, "-c")) cyclops = true;
+    else if (!strcmp(arg, "-r")) raw = true;
+    else if (value && !strcmp(arg, "-t")) seconds = strtoul(argv[++i], nullptr, 0);
+    else if (value && !strcmp(arg, "-f")) fps = atoi(argv[++i]);
+    else if (value && !strcmp(arg, "-s")) seed = strtoul(argv[++i], nullptr, 0);
+    else if (value && !strcmp(arg, "-m")) mood = atoi(argv[++i]);
+    else if (value && !strcmp(arg, "-p")) prefix = argv[++i];
+    else if (value && !strcmp(arg, "-n")) every = max(atoi(argv[++i]), 1);
+    else {
+      fprintf(stderr, "usage: %s [-t seconds] [-f fps] [-s seed] [-m mood] [-c] [-p prefix [-n n]] [-r]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (fps < 1 || fps > 100) fps = 50;
+
+  TFT_eSPI tft;
+  TFT_RoboEyes eyes(tft, false, 3);
+  eyes.setClock(hostClock);
+  eyes.setRandomSeed(seed);
+  eyes.begin(fps);
+  eyes.setAutoblinker(true, 3, 2);
+  eyes.setIdleMode(true, 2, 2);
+  eyes.setMood(mood);
+  eyes.setCyclops(cyclops);
+
+  FilePrint out(stdout);
+  const unsigned long frames = seconds * fps;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (unsigned long f = 0; f < frames; f++) {
+    hostMillis = f * 1000 / fps;
+    hostMicros = f * 1000000 / fps;
+    eyes.update();
+    if (raw) fwrite(tft.fb.data(), 2, tft.fb.size(), stdout);
+    if (prefix && f % every == 0) {
+      char name[256];
+      snprintf(name, sizeof(name), "%s_%06lu.ppm", prefix, f);
+      FILE *file = fopen(name, "wb");
+      if (!file) {
+        fprintf(stderr, "cannot write %s\n", name);
+        return 1;
+      }
+      FilePrint ppm(file);
+      eyes.writeFramePPM(ppm);
+      fclose(file);
+    }
+  }
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  fprintf(stderr, "%lu frames (%lu s simulated) in %.2f s, %u skipped, last checksum %08x\n", frames, seconds, wall,
+          eyes.framesSkipped(), eyes.getFrameChecksum());
+  return 0;
+}
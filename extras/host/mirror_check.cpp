@@ -0,0 +1,209 @@
+// Mirror stream (setMirror()) piped into tools/roboeyes_mirror.py: every
+// frame the decoder writes out must equal the panel after the update()
+// that sent it. Plain, DMA, band, render scale 2, layer, texture and fade
+// runs of 4 simulated seconds each, with a keyframe every 50 frames.
+//
+// A sink that goes down in the middle of a record must only lose that
+// record, and a dead sink must be written to no more than once per
+// keyframe interval. A sink with a small buffer that drains slowly must
+// drop whole frames and decode the rest; one whose buffer is full must be
+// dropped once and left alone for a keyframe interval. All other sinks
+// report 0 from availableForWrite(), like Print, and must get every
+// frame.
+//
+// Usage: mirror [decoder] (default ../../tools/roboeyes_mirror.py, run
+// with python3). Exit status 0 when every frame matches.
+
+#include <functional>
+#include <string>
+#include <unistd.h>
+#include "RoboEyesTFT_eSPI.h"
+
+static unsigned long hostClock() { return hostMillis; }
+
+// Writes into a pipe; can be made to take only some bytes, like a socket
+// that drops in the middle of a write, or to report little room, like a
+// UART with a small transmit buffer
+class PipeSink : public Print {
+  public:
+    FILE *pipe = nullptr;
+    unsigned long bytes = 0, calls = 0;
+    long budget = -1;  // bytes it still takes, -1 = all
+    bool cut = false;  // refused bytes since the last check
+    long room = -1;    // availableForWrite(), -1 = Print's (0, not known)
+
+    int availableForWrite() { return room < 0 ? Print::availableForWrite() : room; }
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) {
+      calls++;
+      size_t n = size;
+      if (budget >= 0 && (long)n > budget) {
+        n = budget;
+        cut = true;
+      }
+      if (budget >= 0) budget -= n;
+      if (room >= 0) room = n < (size_t)room ? room - n : 0;
+      if (pipe) fwrite(buffer, 1, n, pipe);
+      bytes += n;
+      return n;
+    }
+};
+
+struct Config {
+  const char *name;
+  std::function<void(TFT_RoboEyes &)> setup;  // before begin()
+  std::function<void(TFT_RoboEyes &, PipeSink &, int)> frame;  // before update() of frame f
+  int drops = 0;  // frames that must be dropped for want of room, -1 = some
+};
+
+static uint16_t background[240 * 135], iris[32 * 32];
+
+static void drawHud(TFT_eSprite &sprite, void *) {
+  sprite.fillRect(10, 10, 50, 8, TFT_GREEN);
+}
+
+static void none(TFT_RoboEyes &, PipeSink &, int) {}
+
+static const Config configs[] = {
+  {"plain", [](TFT_RoboEyes &) {}, none},
+  {"dma", [](TFT_RoboEyes &e) { e.setDoubleBuffered(true); }, none},
+  {"bands", [](TFT_RoboEyes &e) { e.setBandRendering(4); }, none},
+  {"scale2", [](TFT_RoboEyes &e) { e.setRenderScale(2); }, none},
+  {"layers", [](TFT_RoboEyes &e) {
+     e.setBackground(0, background);
+     e.addOverlay(0, 10, 10, 50, 8, drawHud);
+   }, none},
+  {"textures", [](TFT_RoboEyes &e) { e.setEyeTexture(0, iris, 32, 32, 70); }, none},
+  {"fade", [](TFT_RoboEyes &) {}, [](TFT_RoboEyes &e, PipeSink &, int f) {
+     if (f == 60) e.fadeColors(TFT_RED, TFT_BLUE, 600);
+     if (f == 130) e.fadeColors(TFT_YELLOW, TFT_BLACK, 300);
+   }},
+  {"cut", [](TFT_RoboEyes &) {}, [](TFT_RoboEyes &, PipeSink &sink, int f) {
+     if (f == 77) sink.budget = 9;  // goes down inside the next record
+     else sink.budget = -1;
+   }},
+  {"slow", [](TFT_RoboEyes &e) { e.setEyeTexture(0, iris, 32, 32, 70); }, [](TFT_RoboEyes &, PipeSink &sink, int f) {
+     sink.room = f == 0 ? 8192 : min(sink.room + 1000, 8192L);  // 8 KB buffer, drains 1000 bytes a frame
+   }, -1},
+  {"full", [](TFT_RoboEyes &) {}, [](TFT_RoboEyes &, PipeSink &sink, int f) {
+     sink.room = f >= 60 && f < 90 ? 1 : -1;  // buffer full for 30 frames
+   }, 1},
+};
+
+// The panel as the decoder writes it: RGB565 expanded like writeFramePPM()
+static std::string panelPPM(TFT_eSPI &tft) {
+  std::vector<uint16_t> panel = tft.shown();
+  std::string out = "P6\n" + std::to_string(tft.width()) + " " + std::to_string(tft.height()) + "\n255\n";
+  for (uint16_t c : panel) {
+    out += (char)((c >> 8) & 0xF8);
+    out += (char)((c >> 3) & 0xFC);
+    out += (char)((c << 3) & 0xF8);
+  }
+  return out;
+}
+
+static bool readFile(const std::string &path, std::string &data) {
+  FILE *in = fopen(path.c_str(), "rb");
+  if (!in) return false;
+  data.clear();
+  char chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0) data.append(chunk, n);
+  fclose(in);
+  return true;
+}
+
+// Frames that differ from the panel, or are missing or extra, plus one
+// if the wrong number of frames was dropped
+static int run(const Config &config, const char *decoder) {
+  char dir[] = "/tmp/roboeyes_mirror_XXXXXX";
+  if (!mkdtemp(dir)) return -1;
+  std::string prefix = std::string(dir) + "/frame", log = std::string(dir) + "/log";
+  std::string command = "python3 " + std::string(decoder) + " - -o " + prefix + " 2>" + log;
+
+  hostMillis = hostMicros = 0;
+  TFT_eSPI tft;
+  TFT_RoboEyes eyes(tft, false, 3);
+  eyes.setClock(hostClock);
+  eyes.setRandomSeed(1);
+  config.setup(eyes);
+  eyes.begin(50);
+  eyes.setAutoblinker(true, 1, 1);
+  eyes.setIdleMode(true, 1, 1);
+  PipeSink sink;
+  sink.pipe = popen(command.c_str(), "w");
+  if (!sink.pipe) return -1;
+  eyes.setMirror(&sink, 0, 50);
+
+  std::vector<std::string> expected;  // the panel after each record sent whole
+  for (int f = 0; f < 200; f++) {
+    config.frame(eyes, sink, f);
+    if (f % 50 == 25) eyes.setMood(f / 50 % 4);
+    hostAdvance(20);
+    unsigned long before = sink.bytes;
+    sink.cut = false;
+    eyes.update();
+    if (sink.bytes != before && !sink.cut) expected.push_back(panelPPM(tft));
+  }
+  pclose(sink.pipe);
+
+  int bad = 0;
+  std::string data, report;
+  for (size_t i = 0; i < expected.size(); i++) {
+    char name[32];
+    snprintf(name, sizeof(name), "_%05zu.ppm", i + 1);
+    std::string path = prefix + name;
+    if (!readFile(path, data) || data != expected[i]) bad++;
+    unlink(path.c_str());
+  }
+  char name[32];
+  snprintf(name, sizeof(name), "_%05zu.ppm", expected.size() + 1);
+  if (readFile(prefix + name, data)) bad++;  // decoded a frame too many
+  uint32_t dropped = eyes.getMirrorDropped();
+  if (config.drops < 0 ? dropped == 0 : dropped != (uint32_t)config.drops) bad++;
+  unlink((prefix + name).c_str());
+  readFile(log, report);
+  while (!report.empty() && report.back() == '\n') report.pop_back();
+  printf("%-9s %5zu frames sent, %3u dropped, %6lu bytes, %3d bad | decoder: %s\n", config.name, expected.size(),
+         dropped, sink.bytes, bad, report.c_str());
+  unlink(log.c_str());
+  rmdir(dir);
+  return bad;
+}
+
+// Write calls a sink that takes nothing sees over 1000 frames
+static unsigned long deadSinkCalls() {
+  hostMillis = hostMicros = 0;
+  TFT_eSPI tft;
+  TFT_RoboEyes eyes(tft, false, 3);
+  eyes.setClock(hostClock);
+  eyes.setRandomSeed(1);
+  eyes.begin(50);
+  eyes.setHFlicker(true, 2);  // a frame to send every time
+  PipeSink sink;
+  sink.budget = 0;
+  eyes.setMirror(&sink, 0, 50);
+  for (int f = 0; f < 1000; f++) {
+    hostAdvance(20);
+    eyes.update();
+  }
+  return sink.calls;
+}
+
+int main(int argc, char **argv) {
+  const char *decoder = argc > 1 ? argv[1] : "../../tools/roboeyes_mirror.py";
+  for (int i = 0; i < 240 * 135; i++) background[i] = (i % 240 / 8) << 11 | (i / 240 / 3) << 5 | 4;
+  for (int i = 0; i < 32 * 32; i++) iris[i] = (i * 2654435761u) >> 16 | 0x0821;
+
+  bool ok = true;
+  for (const Config &config : configs) {
+    int bad = run(config, decoder);
+    if (bad < 0) printf("%-9s cannot run %s\n", config.name, decoder);
+    ok &= bad == 0;
+  }
+  unsigned long calls = deadSinkCalls();
+  printf("dead sink: %lu write calls in 1000 frames\n", calls);
+  ok &= calls <= 1000 / 50 + 1;
+  printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+// The same tired-mood run drawn by TFT_RoboEyes (every feature, size and
+// depth read at run time) and by RoboEyes<240, 135, 1, ROBOEYES_FEATURE_TIRED>.
+// Built twice by the Makefile, with and without -DSPECIALIZED=1; `make
+// compare` prints the text size of both programs and their time per frame.
+// Both builds must print the same panel checksum.
+
+#include <chrono>
+#include "RoboEyesTFT_eSPI.h"
+
+using Clock = std::chrono::steady_clock;
+
+#if SPECIALIZED
+typedef RoboEyes<240, 135, 1, ROBOEYES_FEATURE_TIRED> Eyes;
+static const char *name = "RoboEyes<240,135,1,TIRED>";
+#else
+typedef TFT_RoboEyes Eyes;
+static const char *name = "TFT_RoboEyes";
+#endif
+
+// FNV-1a over the panel
+static uint32_t panelChecksum(const TFT_eSPI &tft) {
+  uint32_t h = 2166136261UL;
+  for (uint16_t color : tft.fb) {
+    h = (h ^ (color >> 8)) * 16777619UL;
+    h = (h ^ (color & 0xFF)) * 16777619UL;
+  }
+  return h;
+}
+
+// One run of 10 simulated minutes; returns ns per drawn frame
+static double run(uint32_t &checksum, unsigned &frames) {
+  hostMillis = hostMicros = 0;
+  randomSeed(1);
+  TFT_eSPI tft;
+#if SPECIALIZED
+  Eyes eyes(tft, 3);
+#else
+  Eyes eyes(tft, false, 3);
+  eyes.setColorDepth(1);
+#endif
+  eyes.begin(50);
+  eyes.setAutoblinker(true, 1, 1);
+  eyes.setIdleMode(true, 1, 1);
+  eyes.setMood(TIRED);
+
+  double ns = 0;
+  frames = 0;
+  checksum = 0;
+  for (int f = 0; f < 30000; f++) {
+    hostAdvance(20);
+    Clock::time_point start = Clock::now();
+    eyes.update();
+    ns += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    if (!eyes.isIdle()) frames++;
+    if (f % 100 == 0) checksum = checksum * 31 + panelChecksum(tft);
+  }
+  return ns / (frames ? frames : 1);
+}
+
+// Best of five runs, to keep other load on the host out of the figure
+int main() {
+  uint32_t checksum;
+  unsigned frames;
+  double best = run(checksum, frames);
+  for (int i = 1; i < 5; i++) best = min(best, run(checksum, frames));
+  printf("%-26s %8.0f ns/frame (%u frames drawn), checksum %08x\n", name, best, frames, checksum);
+  return 0;
+}
@@ -0,0 +1,136 @@
+// Render workers (setRenderWorkers()) at 1, 2 and 4 workers on 240x135,
+// 320x240 and 480x320 panels, eyes scaled to the panel: time per frame
+// with every frame fully redrawn, the speed-up over one worker and
+// whether the frame buffer bytes match the single worker's. Workers are
+// std::threads, so the speed-up depends on the cores the host gives the
+// program.
+//
+// Then eyes of unequal height 1 px apart run through update() at 1 and 4
+// bits, so dirty rects side by side share bytes; the frames must match
+// the single worker's. Build with -fsanitize=thread to check for races.
+//
+// Usage: workers [depth ...] [-n frames] (default: 16 1, 300 frames).
+// Exit status 0 when every frame matches.
+
+#define ROBOEYES_TASK 1
+#define ROBOEYES_WORKERS 4
+#include "freertos_host.h"
+#include "RoboEyesTFT_eSPI.h"
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static unsigned long hostClock() { return hostMillis; }
+
+class Bench : public TFT_RoboEyes {
+  public:
+    using TFT_RoboEyes::TFT_RoboEyes;
+
+    // Microseconds for one frame drawn from scratch
+    double frame() {
+      fullRedraw = true;
+      Clock::time_point start = Clock::now();
+      drawEyes();
+      return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+
+    uint32_t bufferChecksum() {
+      const Surface &sf = surfaces[0];
+      const uint8_t *p = sf.pixels;
+      uint32_t h = 2166136261UL;
+      for (uint32_t i = 0; i < (uint32_t)sf.stride * rasterHeight(sf); i++) h = (h ^ p[i]) * 16777619UL;
+      return h;
+    }
+};
+
+// Fold of the frame checksums of 400 updates with count workers
+static uint32_t sharedBytes(int depth, uint8_t count) {
+  hostMillis = hostMicros = 0;
+  TFT_eSPI tft;
+  TFT_RoboEyes eyes(tft, false, 3);
+  eyes.setClock(hostClock);
+  eyes.setRandomSeed(5);
+  eyes.setColorDepth(depth);
+  eyes.setSpacebetween(1);
+  eyes.setHeight(60, 30);
+  eyes.setRenderWorkers(count);
+  eyes.begin(50);
+  eyes.setIdleMode(true, 1, 1);
+  eyes.setAutoblinker(true, 1, 1);
+  uint32_t sum = 2166136261UL;
+  for (int f = 0; f < 400; f++) {
+    hostAdvance(20);
+    eyes.update();
+    sum = (sum ^ eyes.getFrameChecksum()) * 16777619UL;
+  }
+  eyes.setRenderWorkers(1);
+  return sum;
+}
+
+int main(int argc, char **argv) {
+  std::vector<int> depths;
+  int frames = 300;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-n") && i + 1 < argc) frames = atoi(argv[++i]);
+    else depths.push_back(atoi(argv[i]));
+  }
+  if (depths.empty()) depths = {16, 1};
+
+  static const int sizes[][2] = {{240, 135}, {320, 240}, {480, 320}};
+  printf("%u hardware threads\n", std::thread::hardware_concurrency());
+  printf("%-8s %5s %7s %9s %8s %s\n", "panel", "depth", "workers", "us/frame", "speed-up", "frames");
+  bool ok = true;
+  for (int depth : depths)
+    for (const auto &size : sizes) {
+      double base = 0;
+      uint32_t reference = 0;
+      for (uint8_t count : {1, 2, 4}) {
+        hostMillis = hostMicros = 0;
+        TFT_eSPI tft(size[0], size[1]);
+        Bench eyes(tft, false, 1);
+        eyes.setClock(hostClock);
+        eyes.setRandomSeed(3);
+        eyes.setScreenSize(size[0], size[1]);
+        eyes.setColorDepth(depth);
+        eyes.setWidth(size[0] * 2 / 5, size[0] * 2 / 5);
+        eyes.setHeight(size[1] * 3 / 5, size[1] * 3 / 5);
+        eyes.setBorderradius(size[1] / 8, size[1] / 8);
+        eyes.setSpacebetween(size[0] / 10);
+        if (!eyes.setRenderWorkers(count)) {
+          printf("%d workers did not start\n", count);
+          return 1;
+        }
+        eyes.begin(50);
+        eyes.setMood(TIRED);
+        eyes.setIdleMode(true, 1, 1);
+        eyes.setAutoblinker(true, 1, 1);
+
+        double total = 0;
+        uint32_t sum = 2166136261UL;
+        for (int f = 0; f < frames; f++) {
+          hostAdvance(20);
+          if (f == frames / 2) eyes.setMood(HAPPY);
+          total += eyes.frame();
+          sum = (sum ^ eyes.bufferChecksum()) * 16777619UL;
+        }
+        if (count == 1) {
+          base = total;
+          reference = sum;
+        }
+        ok &= sum == reference;
+        printf("%3dx%-4d %5d %7u %9.1f %7.2fx %s\n", size[0], size[1], depth, eyes.getRenderWorkers(),
+               total / frames, base / total, sum == reference ? "same" : "DIFFERENT");
+        eyes.setRenderWorkers(1);
+      }
+    }
+  for (int depth : {1, 4}) {
+    uint32_t reference = sharedBytes(depth, 1);
+    for (uint8_t count : {2, 4}) {
+      bool same = sharedBytes(depth, count) == reference;
+      printf("side by side, depth %d, %u workers: %s\n", depth, count, same ? "same" : "DIFFERENT");
+      ok &= same;
+    }
+  }
+  printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
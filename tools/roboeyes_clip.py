@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""Compile RoboEyes animation clips from text into the binary clip format
+read by TFT_RoboEyes::playClip() (see ROBOEYES_CLIP_VERSION).
+
+    # bounce 5 px for ~500 ms
+    clip LAUGH length 40 loops 12
+    track y step
+      0   5
+      20 -5
+
+A file may hold several clips. A track is `track <param> <curve>`, with an
+optional `eyes 0,1` to limit it to some eyes, followed by `time value`
+lines (ms into the pass, ascending).
+  params: x y close width height tired angry happy
+  curves: step linear ease_in ease_out ease_in_out
+
+Writes a C header with one PROGMEM array per clip, or with --bin the raw
+bytes of a single clip (for a file mapped from flash).
+
+    python3 roboeyes_clip.py clips.txt -o clips.h
+"""
+
+import argparse
+import struct
+import sys
+
+VERSION = 1
+PARAMS = ["x", "y", "close", "width", "height", "tired", "angry", "happy"]
+CURVES = ["step", "linear", "ease_in", "ease_out", "ease_in_out"]
+
+
+def fail(lineno, msg):
+    sys.exit("line %d: %s" % (lineno, msg))
+
+
+def parse(text):
+    clips = []
+    for lineno, line in enumerate(text.splitlines(), 1):
+        words = line.split("#", 1)[0].split()
+        if not words:
+            continue
+        if words[0] == "clip":
+            if len(words) < 2:
+                fail(lineno, "clip needs a name")
+            opts = dict(zip(words[2::2], words[3::2]))
+            clips.append({"name": words[1],
+                          "length": int(opts.get("length", 0)),
+                          "loops": int(opts.get("loops", 1)),
+                          "tracks": []})
+        elif words[0] == "track":
+            if not clips:
+                fail(lineno, "track outside a clip")
+            if len(words) < 3 or words[1] not in PARAMS or words[2] not in CURVES:
+                fail(lineno, "expected: track <param> <curve> [eyes i,j]")
+            mask = 0
+            if len(words) >= 5 and words[3] == "eyes":
+                for i in words[4].split(","):
+                    mask |= 1 << int(i)
+            clips[-1]["tracks"].append({"param": PARAMS.index(words[1]),
+                                        "curve": CURVES.index(words[2]),
+                                        "mask": mask, "keys": []})
+        else:
+            if not clips or not clips[-1]["tracks"]:
+                fail(lineno, "key outside a track")
+            if len(words) != 2:
+                fail(lineno, "expected: <time> <value>")
+            keys = clips[-1]["tracks"][-1]["keys"]
+            t, v = int(words[0]), int(words[1])
+            if keys and t < keys[-1][0]:
+                fail(lineno, "key times must ascend")
+            keys.append((t, v))
+
+    for clip in clips:
+        if not clip["length"]:
+            clip["length"] = max([k[-1][0] for k in
+                                  (t["keys"] for t in clip["tracks"]) if k] or [0])
+    return clips
+
+
+def encode(clip):
+    if len(clip["tracks"]) > 255 or not 0 <= clip["loops"] <= 255:
+        sys.exit("%s: too many tracks or loops" % clip["name"])
+    out = bytearray(b"RE")
+    out += struct.pack("<BBHBB", VERSION, len(clip["tracks"]),
+                       clip["length"], clip["loops"], 0)
+    for track in clip["tracks"]:
+        out += struct.pack("<BBBB", track["param"], track["curve"],
+                           track["mask"], len(track["keys"]))
+        for t, v in track["keys"]:
+            out += struct.pack("<Hh", t, v)
+    return bytes(out)
+
+
+def header(clips, source):
+    lines = ["// Generated by roboeyes_clip.py from %s, do not edit" % source, ""]
+    for clip in clips:
+        data = encode(clip)
+        lines.append("static const uint8_t %s[] PROGMEM = {" % clip["name"])
+        for i in range(0, len(data), 12):
+            lines.append("  " + ", ".join("0x%02X" % b for b in data[i:i + 12]) + ",")
+        lines.append("};")
+        lines.append("")
+    return "\n".join(lines)
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Compile RoboEyes animation clips")
+    ap.add_argument("source", help="clip description (text)")
+    ap.add_argument("-o", "--output", help="output file (default: stdout)")
+    ap.add_argument("--bin", action="store_true",
+                    help="write the raw bytes of a single clip")
+    args = ap.parse_args()
+
+    with open(args.source) as f:
+        clips = parse(f.read())
+    if not clips:
+        sys.exit("no clips in %s" % args.source)
+
+    if args.bin:
+        if len(clips) != 1:
+            sys.exit("--bin takes a file with exactly one clip")
+        if not args.output:
+            sys.exit("--bin needs -o")
+        with open(args.output, "wb") as f:
+            f.write(encode(clips[0]))
+    else:
+        text = header(clips, args.source)
+        if args.output:
+            with open(args.output, "w") as f:
+                f.write(text)
+        else:
+            sys.stdout.write(text)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+"""Decode the mirror stream written by TFT_RoboEyes::setMirror() into PPM
+images, one per frame (see setMirror() for the record format).
+
+    # from a capture, every frame
+    python3 roboeyes_mirror.py capture.bin -o frames/eyes
+
+    # live from a serial port or socket, keeping only the latest frame
+    nc unit.local 2323 | python3 roboeyes_mirror.py - --last eyes.ppm
+
+Records that are cut short or corrupted are dropped; deltas are only
+applied on top of the frame they follow, so decoding resumes with the
+next keyframe.
+"""
+
+import argparse
+import sys
+
+VERSION = 1
+MAX_PIXELS = 4096 * 4096
+
+
+class Corrupt(Exception):
+    pass
+
+
+class Reader:
+    """Bytes of a stream, with a Fletcher-16 over what was read since
+    reset(). rewind() reads them again, to look for the next record inside
+    one that turned out to be corrupt."""
+
+    def __init__(self, f):
+        self.f = f
+        self.again = bytearray()
+        self.at = 0
+        self.reset()
+
+    def reset(self):
+        self.a = self.b = 0
+        self.taken = bytearray()
+
+    def rewind(self):
+        self.again = self.taken + self.again[self.at:]
+        self.at = 0
+        self.reset()
+
+    def u8(self):
+        if self.at < len(self.again):
+            v = self.again[self.at]
+            self.at += 1
+        else:
+            data = self.f.read(1)
+            if not data:
+                raise EOFError
+            v = data[0]
+        self.taken.append(v)
+        self.a = (self.a + v) % 255
+        self.b = (self.b + self.a) % 255
+        return v
+
+    def u16(self):
+        lo = self.u8()
+        return lo | (self.u8() << 8)
+
+    def sum(self):
+        return (self.b << 8) | self.a
+
+
+class Screen:
+    def __init__(self, width, height):
+        self.width, self.height = width, height
+        self.pixels = [0] * (width * height)
+        self.palette = []
+        self.frame = None
+
+
+def sync(r):
+    """Skip to just after the next 'RM'"""
+    prev = None
+    while True:
+        c = r.u8()
+        if prev == ord("R") and c == ord("M"):
+            return
+        prev = c
+        r.reset()
+
+
+def record(r, screens):
+    """Decode one record; returns (surface, screen) if it gave a new frame"""
+    r.reset()
+    if r.u8() != VERSION:
+        raise Corrupt("unknown version")
+    kind = r.u8()
+    surface = r.u8()
+    frame = r.u16()
+    width, height = r.u16(), r.u16()
+    ranges = r.u8()
+    if kind not in (ord("K"), ord("D")) or width * height > MAX_PIXELS:
+        raise Corrupt("bad header")
+
+    last = screens.get(surface)
+    follows = (last is not None and last.frame is not None
+               and (last.width, last.height) == (width, height)
+               and frame == (last.frame + 1) & 0xFFFF)
+    screen = Screen(width, height)
+    if kind == ord("D") and follows:
+        screen.pixels = list(last.pixels)
+        screen.palette = list(last.palette)
+
+    for _ in range(ranges):
+        y, rows = r.u16(), r.u16()
+        if y + rows > height:
+            raise Corrupt("rows out of range")
+        for row in range(y, y + rows):
+            x, at = 0, row * width
+            while x < width:
+                b = r.u8()
+                length = r.u16() if b >> 4 == 15 else (b >> 4) + 1
+                if b & 15 == 15:
+                    color = r.u16()
+                    if len(screen.palette) < 15:
+                        screen.palette.append(color)
+                elif b & 15 < len(screen.palette):
+                    color = screen.palette[b & 15]
+                else:
+                    raise Corrupt("unknown color index")
+                if x + length > width:
+                    raise Corrupt("run past the end of the row")
+                screen.pixels[at + x:at + x + length] = [color] * length
+                x += length
+
+    expected = r.sum()
+    if r.u16() != expected:
+        raise Corrupt("checksum")
+    if kind == ord("D") and not follows:
+        return None  # the frame it changes is missing: wait for a keyframe
+    screen.frame = frame
+    screens[surface] = screen
+    return surface, screen
+
+
+def ppm(screen):
+    out = bytearray(b"P6\n%d %d\n255\n" % (screen.width, screen.height))
+    for c in screen.pixels:
+        out += bytes(((c >> 8) & 0xF8, (c >> 3) & 0xFC, (c << 3) & 0xF8))
+    return bytes(out)
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Decode a RoboEyes mirror stream to PPM")
+    ap.add_argument("source", help="captured stream, or - for stdin")
+    ap.add_argument("-o", "--output", default="frame",
+                    help="prefix of the images written (default: frame)")
+    ap.add_argument("--last", metavar="FILE",
+                    help="only keep the latest frame, in FILE")
+    ap.add_argument("--surface", type=int, default=0,
+                    help="surface to decode (default: 0)")
+    args = ap.parse_args()
+
+    f = sys.stdin.buffer if args.source == "-" else open(args.source, "rb")
+    r = Reader(f)
+    screens = {}
+    frames = dropped = 0
+    try:
+        while True:
+            sync(r)
+            try:
+                got = record(r, screens)
+            except Corrupt:
+                dropped += 1
+                r.rewind()
+                continue
+            if not got or got[0] != args.surface:
+                continue
+            frames += 1
+            name = args.last or "%s_%05d.ppm" % (args.output, frames)
+            with open(name, "wb") as out:
+                out.write(ppm(got[1]))
+    except (EOFError, KeyboardInterrupt):
+        pass
+    sys.stderr.write("%d frames, %d records dropped\n" % (frames, dropped))
+
+
+if __name__ == "__main__":
+    main()